@@ -18,10 +18,26 @@
 #include <linux/regulator/consumer.h>
 #include <linux/atomic.h>
 #include <linux/workqueue.h>
+#include <linux/list.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/interrupt.h>
+#include <linux/bitmap.h>
+#include <linux/random.h>
+#include <linux/sort.h>
+#include <linux/lz4.h>
+#include <linux/zstd.h>
+#include <linux/xxhash.h>
+#include <linux/math64.h>
+#include <linux/uaccess.h>
+#include <asm/unaligned.h>
 
 #include <sound/soc.h>
 #include <sound/pcm.h>
 #include <sound/initval.h>
+#include <sound/tlv.h>
 
 /* register address */
 #define REG_PAGE		0x00
@@ -30,6 +46,8 @@
 #define REG_GLOBAL_FAULT1	0x17
 #define REG_GLOBAL_FAULT2	0x18
 #define REG_GLOBAL_FAULT3	0x19
+#define REG_SAP_CTRL1		0x05
+#define REG_SAP_CTRL2		0x06
 
 /* DEVICE_STATE register values */
 #define DEVICE_STATE_DEEP_SLEEP	0x00
@@ -39,6 +57,28 @@
 
 #define DEVICE_STATE_MUTE	0x0C
 
+/* STATE_REPORT and GLOBAL_FAULT1..3 are read in one transaction */
+#define ACM8623_FAULT_REGS	(REG_GLOBAL_FAULT3 - REG_STATE_REPORT + 1)
+
+/* SAP_CTRL1 register (0x05): serial data format in bits 5:4, 00 I2S,
+ * 01 DSP, 10 right-justified, 11 left-justified. Right-justified is
+ * not offered as the word length is never programmed. The other bits
+ * keep their reset value.
+ */
+#define SAP_FMT_MASK		GENMASK(5, 4)
+#define SAP_FMT_I2S		0x00
+#define SAP_FMT_DSP		0x10
+#define SAP_FMT_LEFT_J		0x30
+
+/* SAP_CTRL2 register (0x06): BCLK and LRCLK inversion in bits 7:6, and
+ * a one BCLK data offset in bit 0 that selects DSP_A over DSP_B. The
+ * other bits keep their reset value.
+ */
+#define SAP_BCLK_INV		BIT(7)
+#define SAP_LRCLK_INV		BIT(6)
+#define SAP_DATA_OFFSET_1	BIT(0)
+#define SAP_CTRL2_MASK		(SAP_BCLK_INV | SAP_LRCLK_INV | SAP_DATA_OFFSET_1)
+
 /* This sequence of register writes must always be sent, prior to the
  * 5ms delay while we wait for the DSP to boot.
  */
@@ -138,102 +178,486 @@ static const uint8_t dsp_cfg_default[] = {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03
 };
 
-static const uint32_t acm8623_volume[] = {
-    0x000001A8, /*   0, -110dB */ 0x000001DC, /*   1, -109dB */
-    0x00000216, /*   2, -108dB */ 0x00000258, /*   3, -107dB */
-    0x000002A1, /*   4, -106dB */ 0x000002F3, /*   5, -105dB */
-    0x0000034F, /*   6, -104dB */ 0x000003B6, /*   7, -103dB */
-    0x0000042A, /*   8, -102dB */ 0x000004AC, /*   9, -101dB */
-    0x0000053E, /*  10, -100dB */ 0x000005E2, /*  11,  -99dB */
-    0x0000069A, /*  12,  -98dB */ 0x00000768, /*  13,  -97dB */
-    0x0000084F, /*  14,  -96dB */ 0x00000953, /*  15,  -95dB */
-    0x00000A76, /*  16,  -94dB */ 0x00000BBD, /*  17,  -93dB */
-    0x00000D2B, /*  18,  -92dB */ 0x00000EC7, /*  19,  -91dB */
-    0x00001094, /*  20,  -90dB */ 0x0000129A, /*  21,  -89dB */
-    0x000014DF, /*  22,  -88dB */ 0x0000176B, /*  23,  -87dB */
-    0x00001A47, /*  24,  -86dB */ 0x00001D7C, /*  25,  -85dB */
-    0x00002115, /*  26,  -84dB */ 0x0000251E, /*  27,  -83dB */
-    0x000029A5, /*  28,  -82dB */ 0x00002EBA, /*  29,  -81dB */
-    0x0000346E, /*  30,  -80dB */ 0x00003AD3, /*  31,  -79dB */
-    0x00004201, /*  32,  -78dB */ 0x00004A0F, /*  33,  -77dB */
-    0x00005318, /*  34,  -76dB */ 0x00005D3C, /*  35,  -75dB */
-    0x0000689C, /*  36,  -74dB */ 0x00007560, /*  37,  -73dB */
-    0x000083B2, /*  38,  -72dB */ 0x000093C4, /*  39,  -71dB */
-    0x0000A5CB, /*  40,  -70dB */ 0x0000BA06, /*  41,  -69dB */
-    0x0000D0B9, /*  42,  -68dB */ 0x0000EA31, /*  43,  -67dB */
-    0x000106C4, /*  44,  -66dB */ 0x000126D4, /*  45,  -65dB */
-    0x00014ACE, /*  46,  -64dB */ 0x0001732B, /*  47,  -63dB */
-    0x0001A075, /*  48,  -62dB */ 0x0001D346, /*  49,  -61dB */
-    0x00020C4A, /*  50,  -60dB */ 0x00024C43, /*  51,  -59dB */
-    0x0002940A, /*  52,  -58dB */ 0x0002E494, /*  53,  -57dB */
-    0x00033EF1, /*  54,  -56dB */ 0x0003A455, /*  55,  -55dB */
-    0x00041618, /*  56,  -54dB */ 0x000495BC, /*  57,  -53dB */
-    0x000524F4, /*  58,  -52dB */ 0x0005C5A5, /*  59,  -51dB */
-    0x000679F2, /*  60,  -50dB */ 0x0007443E, /*  61,  -49dB */
-    0x0008273A, /*  62,  -48dB */ 0x000925E9, /*  63,  -47dB */
-    0x000A43AA, /*  64,  -46dB */ 0x000B844A, /*  65,  -45dB */
-    0x000CEC09, /*  66,  -44dB */ 0x000E7FAD, /*  67,  -43dB */
-    0x00104491, /*  68,  -42dB */ 0x001240B9, /*  69,  -41dB */
-    0x00147AE1, /*  70,  -40dB */ 0x0016FA9C, /*  71,  -39dB */
-    0x0019C865, /*  72,  -38dB */ 0x001CEDC4, /*  73,  -37dB */
-    0x00207568, /*  74,  -36dB */ 0x00246B4E, /*  75,  -35dB */
-    0x0028DCEC, /*  76,  -34dB */ 0x002DD959, /*  77,  -33dB */
-    0x00337185, /*  78,  -32dB */ 0x0039B872, /*  79,  -31dB */
-    0x0040C371, /*  80,  -30dB */ 0x0048AA71, /*  81,  -29dB */
-    0x00518848, /*  82,  -28dB */ 0x005B7B16, /*  83,  -27dB */
-    0x0066A4A5, /*  84,  -26dB */ 0x00732AE2, /*  85,  -25dB */
-    0x00813856, /*  86,  -24dB */ 0x0090FCBF, /*  87,  -23dB */
-    0x00A2ADAD, /*  88,  -22dB */ 0x00B68738, /*  89,  -21dB */
-    0x00CCCCCD, /*  90,  -20dB */ 0x00E5CA15, /*  91,  -19dB */
-    0x0101D3F3, /*  92,  -18dB */ 0x012149A6, /*  93,  -17dB */
-    0x0144960C, /*  94,  -16dB */ 0x016C310E, /*  95,  -15dB */
-    0x0198A135, /*  96,  -14dB */ 0x01CA7D76, /*  97,  -13dB */
-    0x02026F31, /*  98,  -12dB */ 0x0241346F, /*  99,  -11dB */
-    0x0287A26C, /* 100,  -10dB */ 0x02D6A867, /* 101,   -9dB */
-    0x032F52D0, /* 102,   -8dB */ 0x0392CED9, /* 103,   -7dB */
-    0x04026E74, /* 104,   -6dB */ 0x047FACCF, /* 105,   -5dB */
-    0x050C335D, /* 106,   -4dB */ 0x05A9DF7B, /* 107,   -3dB */
-    0x065AC8C3, /* 108,   -2dB */ 0x0721482C, /* 109,   -1dB */
-    0x08000000, /* 110,    0dB */ 0x08F9E4D0, /* 111,    1dB */
-    0x0A12477C, /* 112,    2dB */ 0x0B4CE07C, /* 113,    3dB */
-    0x0CADDC7B, /* 114,    4dB */ 0x0E39EA8E, /* 115,    5dB */
-    0x0FF64C17, /* 116,    6dB */ 0x11E8E6A1, /* 117,    7dB */
-    0x141857EA, /* 118,    8dB */ 0x168C0C5A, /* 119,    9dB */
-    0x194C583B, /* 120,   10dB */ 0x1C629406, /* 121,   11dB */
-    0x1FD93C1F, /* 122,   12dB */ 0x23BC1479, /* 123,   13dB */
-    0x28185086, /* 124,   14dB */ 0x2CFCC016, /* 125,   15dB */
-    0x327A01A4, /* 126,   16dB */ 0x38A2BACB, /* 127,   17dB */
-    0x3F8BD79E, /* 128,   18dB */ 0x474CD1B8, /* 129,   19dB */
-    0x50000000, /* 130,   20dB */ 0x59C2F01D, /* 131,   21dB */
-    0x64B6CADD, /* 132,   22dB */ 0x7100C4D8, /* 133,   23dB */
-    0x7ECA9CD2, /* 134,   24dB */
+/* 2^(2^-k) for k = 1..24, Q62 */
+static const u64 acm8623_exp2_frac[] = {
+	0x5a827999fcef3242ULL, 0x4c1bf828c6dc54b8ULL,
+	0x45cae0f1f545eb73ULL, 0x42d561b3e6243d8aULL,
+	0x4166c34c5615d0ecULL, 0x40b268f9de0183baULL,
+	0x4058f6a7ecccd5b6ULL, 0x402c6be96af2fb58ULL,
+	0x4016321b687027a8ULL, 0x400b18178ba33b14ULL,
+	0x40058bce410147e8ULL, 0x4002c5d7bff71dafULL,
+	0x400162e807ee7e5bULL, 0x4000b1730df6a524ULL,
+	0x400058b9497b8152ULL, 0x40002c5c955dd701ULL,
+	0x4000162e46d6f26cULL, 0x40000b1722757b1bULL,
+	0x4000058b90fd3e0cULL, 0x400002c5c86f3f26ULL,
+	0x40000162e433c79bULL, 0x400000b17218edd0ULL,
+	0x40000058b90c3968ULL, 0x4000002c5c860d54ULL,
 };
 
-#define ACM8623_VOLUME_MAX	((int)ARRAY_SIZE(acm8623_volume) - 1)
+/* log2(10) / 2000, the power of two of 0.01 dB, Q56 */
+#define ACM8623_DB_LOG2	0x6cda5a437b72LL
+
+/* ln(2), Q30 */
+#define ACM8623_LN2		0x2c5c85feULL
+
+/* Volume coefficients are Q27, 0x08000000 is 0 dB */
+#define ACM8623_VOLUME_Q	27
+
+/* The coefficient of a level in 0.01 dB, rounded to nearest. It is
+ * 2^(level * log2(10) / 2000) shifted by the Q format: the integer
+ * part of the exponent is a shift, the top 24 bits of the fraction
+ * pick factors from the table above and the rest is small enough for
+ * 2^x = 1 + x ln(2).
+ */
+static u32 acm8623_db_to_coef(int level)
+{
+	s64 t = level * ACM8623_DB_LOG2;
+	u64 f = t & GENMASK_ULL(55, 0);
+	u64 r = BIT_ULL(62);
+	int i, shift;
+
+	for (i = 0; i < ARRAY_SIZE(acm8623_exp2_frac); i++)
+		if (f & BIT_ULL(55 - i))
+			r = mul_u64_u64_shr(r, acm8623_exp2_frac[i], 62);
+
+	r += mul_u64_u64_shr(r, (f & GENMASK_ULL(31, 0)) * ACM8623_LN2, 86);
+
+	shift = 62 - ACM8623_VOLUME_Q - (int)(t >> 56);
+	if (shift < 31)
+		return U32_MAX;
+	if (shift > 63)
+		return 0;
+
+	return (r + BIT_ULL(shift - 1)) >> shift;
+}
+
 #define ACM8623_VOLUME_MIN	0
+#define ACM8623_CHANNELS	GENMASK(1, 0)
+
+/* Volume steps of a tuning blob: coef[i] is the scale for min + i *
+ * step, both in 0.01 dB. Without coef it is computed.
+ */
+struct acm8623_curve {
+	int						min;
+	unsigned int			step;
+	unsigned int			count;
+	const u32				*coef;
+};
+
+/* -110 dB to +24 dB in 0.1 dB steps */
+static const struct acm8623_curve acm8623_curve_default = {
+	.min	= -11000,
+	.step	= 10,
+	.count	= 1341,
+};
+
+static u32 acm8623_curve_coef(const struct acm8623_curve *vol, int v)
+{
+	if (vol->coef)
+		return vol->coef[v];
+
+	return acm8623_db_to_coef(vol->min + v * (int)vol->step);
+}
+
+static bool acm8623_curve_equal(const struct acm8623_curve *a,
+				 const struct acm8623_curve *b)
+{
+	if (a->min != b->min || a->step != b->step || a->count != b->count)
+		return false;
+	if (!a->coef || !b->coef)
+		return a->coef == b->coef;
+
+	return !memcmp(a->coef, b->coef, a->count * sizeof(*a->coef));
+}
+
+/* Amplifiers on the same bus that also acknowledge a common group
+ * address and run the same tuning. The shared configuration is
+ * broadcast once; only per-device settings are written individually.
+ */
+struct acm8623_group {
+	struct list_head		node;
+	struct list_head		members;
+
+	struct i2c_adapter		*adapter;
+	struct i2c_client		*client;
+	struct regmap			*regmap;
+
+	/* Number of members, and how many of them are powered up */
+	int						size;
+	int						active;
+
+	/* Value of the group volume control */
+	int						vol;
+	struct mutex			lock;
+};
+
+static LIST_HEAD(acm8623_groups);
+static DEFINE_MUTEX(acm8623_groups_lock);
+
+/* Amplifiers sharing one DAI link boot in parallel and wait for each
+ * other before switching to PLAY, so every zone starts together.
+ */
+struct acm8623_link {
+	struct list_head		node;
+	struct snd_soc_pcm_runtime	*rtd;
+	int						refs;
+
+	/* Barrier: number of instances on the link and how many of
+	 * them have finished booting in the current generation.
+	 */
+	int						members;
+	int						ready;
+	unsigned int			gen;
+	struct list_head		arrived;
+	wait_queue_head_t		wq;
+	struct mutex			lock;
+};
+
+static LIST_HEAD(acm8623_links);
+static DEFINE_MUTEX(acm8623_links_lock);
+
+/* Upper bound on how long a booted instance waits for its link peers */
+#define ACM8623_LINK_TIMEOUT_MS	100
+
+/* Without a fault interrupt the fault registers are polled while
+ * playing. The interval backs off as long as the amplifier is healthy.
+ */
+#define ACM8623_FAULT_POLL_MIN_MS	100
+#define ACM8623_FAULT_POLL_MAX_MS	2000
+
+/* A latched fault is cleared by parking the amplifier in Hi-Z and
+ * restoring it from driver state. Attempts are rate limited, and if
+ * the fault keeps coming back the DSP configuration is resent. The
+ * escalation count is forgotten after a quiet period.
+ */
+#define ACM8623_RECOVERY_INTERVAL_MS	1000
+#define ACM8623_RECOVERY_RETRIES		3
+#define ACM8623_RECOVERY_QUIET_MS		60000
+
+/* Transient bus errors are retried with exponential backoff. A write
+ * that still fails restarts its segment of the tuning blob, which
+ * begins at the last page select, up to SEGMENT_RETRIES times.
+ */
+#define ACM8623_IO_RETRIES			3
+#define ACM8623_IO_BACKOFF_US		100
+#define ACM8623_SEGMENT_RETRIES	2
+
+#define ACM8623_PAGE_SIZE	0x100
+#define ACM8623_PAGES		0x100
+
+/* In sampled verify mode about this many pages are read back */
+#define ACM8623_VERIFY_SAMPLE	2
+
+/* Compressed tuning blobs are told apart by their frame magic, and
+ * may expand to at most FW_MAX_SIZE bytes
+ */
+#define ACM8623_LZ4_MAGIC		0x184d2204
+#define ACM8623_ZSTD_MAGIC		0xfd2fb528
+#define ACM8623_FW_MAX_SIZE	(1 << 20)
+
+/* A tuning blob may start with its own volume curve: "ACMV", the
+ * number of steps (le16), the step (le16) and the lowest level (le32)
+ * in 0.01 dB, then a le32 coefficient per step
+ */
+#define ACM8623_VOL_MAGIC		0x564d4341
+#define ACM8623_VOL_HDR_SIZE	12
+#define ACM8623_VOL_MAX_STEPS	2048
+
+/* DSP profiles that can be listed in acme,dsp-profiles */
+#define ACM8623_MAX_PROFILES	8
+
+/* A profile switch writes unchanged registers rather than starting a
+ * new transaction for gaps up to this size
+ */
+#define ACM8623_DELTA_GAP		2
+
+static int verify;
+module_param(verify, int, 0644);
+MODULE_PARM_DESC(verify, "Read back the DSP config after upload "
+		 "(0 = off, 1 = sampled pages, 2 = all pages)");
+
+/* Register traffic is accounted to the phase that generated it */
+enum acm8623_io_phase {
+	ACM8623_IO_CFG,		/* preboot sequence, tuning blob, format */
+	ACM8623_IO_REFRESH,	/* volume, mute and channel state */
+	ACM8623_IO_CTRL,		/* shutdown and fault reporting */
+	ACM8623_IO_DEBUG,		/* debugfs register dumps */
+	ACM8623_IO_PHASES,
+};
+
+/* Histograms use log2 buckets in ms: bucket 0 is below 1 ms and the
+ * last bucket is open ended.
+ */
+#define ACM8623_HIST_BUCKETS	10
+
+struct acm8623_stats {
+	struct {
+		u64					xfers;
+		u64					bytes;
+		u64					bus_ns;
+	} io[ACM8623_IO_PHASES];
+
+	u64						page_switches;
+	u64						reads;
+	u64						errors;
+	u64						faults;
+	u64						recoveries;
+	u64						reconfigs;
+	u64						retries;
+	u64						segment_retries;
+	u64						failures;
+	u64						verified_pages;
+	u64						verify_mismatches;
+	u64						verify_failures;
+	u64						delta_updates;
+	u64						delta_regs;
+	u64						delta_skipped;
+
+	u32						work_hist[ACM8623_HIST_BUCKETS];
+	u32						latency_hist[ACM8623_HIST_BUCKETS];
+};
 
-#define ACM8623_VOLUME_0DB	110
+/* The value last written to each register of a DSP page, for the
+ * registers whose value is known
+ */
+struct acm8623_shadow {
+	u8						page;
+	DECLARE_BITMAP(valid, ACM8623_PAGE_SIZE);
+	u8						val[ACM8623_PAGE_SIZE];
+};
+
+/* A register sequence compiled for the bus: each segment is one
+ * transaction writing len consecutive registers of a page, with the
+ * values at data[offset]. The upload ends on end_page.
+ */
+struct acm8623_seg {
+	u8						page;
+	u8						reg;
+	u16						len;
+	u32						offset;
+};
+
+struct acm8623_cfg {
+	struct acm8623_seg		*segs;
+	unsigned int			num_segs;
+	u8						*data;
+	unsigned int			len;
+	u8						end_page;
+	struct acm8623_curve	vol;
+};
 
 struct acm8623_priv {
 	struct i2c_client		*i2c;
+	struct snd_soc_component	*component;
 
-	uint8_t					*dsp_cfg_data;
-	int		 				dsp_cfg_len;
+	/* Preboot sequence and the tuning blob of every DSP profile,
+	 * compiled at probe. profile is protected by lock.
+	 */
+	struct acm8623_cfg		preboot;
+	struct acm8623_cfg		*profiles;
+	const char				**profile_names;
+	unsigned int			num_profiles;
+	unsigned int			profile;
+
+	/* Steps of the volume controls, which all profiles share */
+	int						vol_min;
+	unsigned int			vol_step;
+	unsigned int			vol_count;
+
+	/* What the DSP pages the profiles use hold, protected by lock.
+	 * Volume writes are not tracked; the volume is written again
+	 * after every change of the config.
+	 */
+	struct acm8623_shadow	*shadow;
+	unsigned int			num_shadow;
 
 	struct regmap			*regmap;
 
 	int						vol[2];
+	int						balance;
 	bool					is_powered;
 	bool					is_muted;
 
+	/* Serial format requested through .set_fmt, applied on
+	 * every DSP startup on top of the tuning blob.
+	 */
+	bool					has_fmt;
+	uint8_t					sap_ctrl1;
+	uint8_t					sap_ctrl2;
+
+	/* Group membership; cfg_valid is protected by group->lock, or
+	 * by lock alone while the instance is counted in group->active
+	 */
+	struct acm8623_group	*group;
+	struct list_head		group_node;
+	bool					cfg_valid;
+
+	/* link_pending is set under lock while the instance waits for
+	 * its link peers to start it, link_synced under link->lock
+	 */
+	struct acm8623_link	*link;
+	struct list_head		link_node;
+	bool					link_pending;
+	bool					link_synced;
+	s64						link_skew_ns;
+
+	/* I/O statistics, protected by lock */
+	struct acm8623_stats	stats;
+	ktime_t					trigger_time;
+	ktime_t					play_time;
+
+	/* Fault monitoring, protected by lock */
+	int						fault_irq;
+	u8						fault[ACM8623_FAULT_REGS];
+	unsigned int			fault_poll_ms;
+	unsigned int			recovery_count;
+	ktime_t					recovery_time;
+	struct delayed_work		fault_work;
+
+	/* Set when a startup gave up on the bus, cleared by the next
+	 * successful one, along with where the last upload gave up
+	 * (page << 8 | reg, -1 if it did not). Protected by lock.
+	 */
+	bool					failed;
+	int						cfg_fail_reg;
+
 	struct work_struct		work;
 	struct mutex			lock;
 };
 
-static void set_dsp_scale(struct regmap *rm, int offset, int vol)
+static void acm8623_account(struct acm8623_priv *acm8623, int phase,
+			     size_t bytes, ktime_t start, int ret)
+{
+	struct acm8623_stats *stats = &acm8623->stats;
+
+	stats->io[phase].xfers++;
+	stats->io[phase].bytes += bytes;
+	stats->io[phase].bus_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (ret)
+		stats->errors++;
+}
+
+/* Called after a failed transaction. Returns true if it should be
+ * tried again.
+ */
+static bool acm8623_retry(struct acm8623_priv *acm8623, int try)
+{
+	unsigned long us = ACM8623_IO_BACKOFF_US << try;
+
+	if (try >= ACM8623_IO_RETRIES)
+		return false;
+
+	acm8623->stats.retries++;
+	usleep_range(us, 2 * us);
+
+	return true;
+}
+
+/* All register accesses go through these so they can be accounted
+ * and retried. Bytes are counted after the address byte: register
+ * plus data.
+ */
+static int acm8623_write(struct acm8623_priv *acm8623, struct regmap *rm,
+			  int phase, unsigned int reg, unsigned int val)
+{
+	ktime_t start;
+	int ret, try = 0;
+
+	do {
+		start = ktime_get();
+		ret = regmap_write(rm, reg, val);
+		acm8623_account(acm8623, phase, 2, start, ret);
+	} while (ret && acm8623_retry(acm8623, try++));
+
+	if (reg == REG_PAGE)
+		acm8623->stats.page_switches++;
+
+	return ret;
+}
+
+static int acm8623_bulk_write(struct acm8623_priv *acm8623,
+			       struct regmap *rm, int phase, unsigned int reg,
+			       const void *val, size_t len)
+{
+	ktime_t start;
+	int ret, try = 0;
+
+	do {
+		start = ktime_get();
+		ret = regmap_bulk_write(rm, reg, val, len);
+		acm8623_account(acm8623, phase, 1 + len, start, ret);
+	} while (ret && acm8623_retry(acm8623, try++));
+
+	return ret;
+}
+
+static int acm8623_read(struct acm8623_priv *acm8623, int phase,
+			 unsigned int reg, unsigned int *val)
+{
+	ktime_t start;
+	int ret, try = 0;
+
+	do {
+		start = ktime_get();
+		ret = regmap_read(acm8623->regmap, reg, val);
+		acm8623_account(acm8623, phase, 2, start, ret);
+		acm8623->stats.reads++;
+	} while (ret && acm8623_retry(acm8623, try++));
+
+	return ret;
+}
+
+static int acm8623_bulk_read(struct acm8623_priv *acm8623, int phase,
+			      unsigned int reg, void *val, size_t len)
+{
+	ktime_t start;
+	int ret, try = 0;
+
+	do {
+		start = ktime_get();
+		ret = regmap_bulk_read(acm8623->regmap, reg, val, len);
+		acm8623_account(acm8623, phase, 1 + len, start, ret);
+		acm8623->stats.reads++;
+	} while (ret && acm8623_retry(acm8623, try++));
+
+	return ret;
+}
+
+static int acm8623_update_bits(struct acm8623_priv *acm8623, int phase,
+				unsigned int reg, unsigned int mask,
+				unsigned int val)
+{
+	unsigned int old, new;
+	int ret;
+
+	ret = acm8623_read(acm8623, phase, reg, &old);
+	if (ret)
+		return ret;
+
+	new = (old & ~mask) | (val & mask);
+	if (new == old)
+		return 0;
+
+	return acm8623_write(acm8623, acm8623->regmap, phase, reg, new);
+}
+
+static void acm8623_hist_add(u32 *hist, ktime_t delta)
+{
+	unsigned int ms = ktime_to_ms(delta);
+
+	hist[min_t(int, fls(ms), ACM8623_HIST_BUCKETS - 1)]++;
+}
+
+static const struct acm8623_cfg *acm8623_cfg(struct acm8623_priv *acm8623)
+{
+	return &acm8623->profiles[acm8623->profile];
+}
+
+static int set_dsp_scale(struct acm8623_priv *acm8623, struct regmap *rm,
+			 int offset, int vol)
 {
 	uint8_t v[4];
-	uint32_t x = acm8623_volume[vol];
+	uint32_t x = acm8623_curve_coef(&acm8623_cfg(acm8623)->vol, vol);
 	int i;
 
 	for (i = 0; i < 4; i++) {
@@ -241,37 +665,106 @@ static void set_dsp_scale(struct regmap *rm, int offset, int vol)
 		x >>= 8;
 	}
 
-	regmap_bulk_write(rm, offset, v, ARRAY_SIZE(v));
+	return acm8623_bulk_write(acm8623, rm, ACM8623_IO_REFRESH, offset,
+				   v, ARRAY_SIZE(v));
+}
+
+static unsigned int acm8623_play_state(struct acm8623_priv *acm8623)
+{
+	return (acm8623->is_muted ? DEVICE_STATE_MUTE : 0) |
+		DEVICE_STATE_PLAY;
+}
+
+/* The volume of a channel, less what the balance takes off it. A
+ * positive balance lowers the left channel, a negative one the right.
+ */
+static int acm8623_channel_vol(struct acm8623_priv *acm8623, int ch)
+{
+	int cut = ch ? -acm8623->balance : acm8623->balance;
+
+	return max_t(int, acm8623->vol[ch] - max(cut, 0), ACM8623_VOLUME_MIN);
+}
+
+/* Write the volume of the channels in mask */
+static int acm8623_write_volume(struct acm8623_priv *acm8623,
+				struct regmap *rm, unsigned int mask)
+{
+	int ret, err;
+
+	ret = acm8623_write(acm8623, rm, ACM8623_IO_REFRESH, REG_PAGE, 0x05);
+	if (!ret && (mask & BIT(0)))
+		ret = set_dsp_scale(acm8623, rm, 0xc4,
+				    acm8623_channel_vol(acm8623, 0));
+	if (!ret && (mask & BIT(1)))
+		ret = set_dsp_scale(acm8623, rm, 0xc0,
+				    acm8623_channel_vol(acm8623, 1));
+
+	/* Everything else expects page 0 */
+	err = acm8623_write(acm8623, rm, ACM8623_IO_REFRESH, REG_PAGE, 0x00);
+
+	return ret ?: err;
 }
 
-static void acm8623_refresh(struct acm8623_priv *acm8623)
+static int acm8623_refresh(struct acm8623_priv *acm8623)
 {
 	struct regmap *rm = acm8623->regmap;
+	int ret;
 
 	dev_dbg(&acm8623->i2c->dev, "refresh: is_muted=%d, vol=%d/%d\n",
 		acm8623->is_muted, acm8623->vol[0], acm8623->vol[1]);
 
-	regmap_write(rm, REG_PAGE, 0x05);
-
-	set_dsp_scale(rm, 0xc4, acm8623->vol[0]);
-	set_dsp_scale(rm, 0xc0, acm8623->vol[1]);
+	ret = acm8623_write_volume(acm8623, rm, ACM8623_CHANNELS);
+	if (ret)
+		return ret;
 
-	regmap_write(rm, REG_PAGE, 0x00);
+	/* The link peers switch it to PLAY, with the mute state as it
+	 * is by then
+	 */
+	if (acm8623->link_pending)
+		return 0;
 
 	/* Set/clear digital soft-mute */
-	regmap_write(rm, REG_DEVICE_STATE,
-		(acm8623->is_muted ? DEVICE_STATE_MUTE : 0) |
-		DEVICE_STATE_PLAY);
+	return acm8623_write(acm8623, rm, ACM8623_IO_REFRESH,
+			      REG_DEVICE_STATE, acm8623_play_state(acm8623));
+}
+
+/* The dB scale of the volume controls, from the steps in use */
+static int acm8623_vol_tlv(struct snd_kcontrol *kcontrol, int op_flag,
+			    unsigned int size, unsigned int __user *tlv)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	unsigned int scale[] = {
+		SNDRV_CTL_TLVT_DB_SCALE, 2 * sizeof(unsigned int),
+		acm8623->vol_min,
+		acm8623->vol_step & SNDRV_CTL_TLVD_DB_SCALE_MASK,
+	};
+
+	if (op_flag != SNDRV_CTL_TLV_OP_READ)
+		return -ENXIO;
+	if (size < sizeof(scale))
+		return -ENOMEM;
+	if (copy_to_user(tlv, scale, sizeof(scale)))
+		return -EFAULT;
+
+	return 0;
 }
 
 static int acm8623_vol_info(struct snd_kcontrol *kcontrol,
 			     struct snd_ctl_elem_info *uinfo)
 {
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+
 	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
 	uinfo->count = 2;
 
 	uinfo->value.integer.min = ACM8623_VOLUME_MIN;
-	uinfo->value.integer.max = ACM8623_VOLUME_MAX;
+	uinfo->value.integer.max = acm8623->vol_count - 1;
 	return 0;
 }
 
@@ -291,9 +784,36 @@ static int acm8623_vol_get(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
-static inline int volume_is_valid(int v)
+static inline int volume_is_valid(struct acm8623_priv *acm8623, int v)
+{
+	return (v >= ACM8623_VOLUME_MIN) && (v < acm8623->vol_count);
+}
+
+/* The step closest to 0 dB, where the volume starts */
+static int acm8623_vol_0db(struct acm8623_priv *acm8623)
 {
-	return (v >= ACM8623_VOLUME_MIN) && (v <= ACM8623_VOLUME_MAX);
+	int v = DIV_ROUND_CLOSEST(-acm8623->vol_min, (int)acm8623->vol_step);
+
+	return clamp_t(int, v, ACM8623_VOLUME_MIN, acm8623->vol_count - 1);
+}
+
+/* Write the channels whose level is no longer the one in old, so that
+ * a change to one channel leaves the other alone.
+ */
+static int acm8623_update_channels(struct acm8623_priv *acm8623,
+				   const int *old)
+{
+	unsigned int mask = 0;
+	int ch;
+
+	for (ch = 0; ch < 2; ch++)
+		if (acm8623_channel_vol(acm8623, ch) != old[ch])
+			mask |= BIT(ch);
+
+	if (!mask || !acm8623->is_powered)
+		return 0;
+
+	return acm8623_write_volume(acm8623, acm8623->regmap, mask);
 }
 
 static int acm8623_vol_put(struct snd_kcontrol *kcontrol,
@@ -303,155 +823,1901 @@ static int acm8623_vol_put(struct snd_kcontrol *kcontrol,
 		snd_soc_kcontrol_component(kcontrol);
 	struct acm8623_priv *acm8623 =
 		snd_soc_component_get_drvdata(component);
-	int ret = 0;
+	int old[2], ret = 0;
 
-	if (!(volume_is_valid(ucontrol->value.integer.value[0]) &&
-	      volume_is_valid(ucontrol->value.integer.value[1])))
+	if (!(volume_is_valid(acm8623, ucontrol->value.integer.value[0]) &&
+	      volume_is_valid(acm8623, ucontrol->value.integer.value[1])))
 		return -EINVAL;
 
 	mutex_lock(&acm8623->lock);
 	if (acm8623->vol[0] != ucontrol->value.integer.value[0] ||
 	    acm8623->vol[1] != ucontrol->value.integer.value[1]) {
+		old[0] = acm8623_channel_vol(acm8623, 0);
+		old[1] = acm8623_channel_vol(acm8623, 1);
 		acm8623->vol[0] = ucontrol->value.integer.value[0];
 		acm8623->vol[1] = ucontrol->value.integer.value[1];
 		dev_dbg(component->dev, "set vol=%d/%d (is_powered=%d)\n",
 			acm8623->vol[0], acm8623->vol[1],
 			acm8623->is_powered);
-		if (acm8623->is_powered)
-			acm8623_refresh(acm8623);
-		ret = 1;
+		ret = acm8623_update_channels(acm8623, old) ?: 1;
 	}
 	mutex_unlock(&acm8623->lock);
 
 	return ret;
 }
 
-static const struct snd_kcontrol_new acm8623_snd_controls[] = {
-	{
-		.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
-		.name	= "Master Playback Volume",
-		.access	= SNDRV_CTL_ELEM_ACCESS_TLV_READ |
-			  SNDRV_CTL_ELEM_ACCESS_READWRITE,
-		.info	= acm8623_vol_info,
-		.get	= acm8623_vol_get,
-		.put	= acm8623_vol_put,
-	},
-};
-
-static void send_cfg(struct regmap *rm,
-		     const uint8_t *s, unsigned int len)
+static int acm8623_balance_info(struct snd_kcontrol *kcontrol,
+				struct snd_ctl_elem_info *uinfo)
 {
-	unsigned int i;
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
 
-	for (i = 0; i + 1 < len; i += 2) {
-		regmap_write(rm, s[i], s[i + 1]);
-	}
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+
+	uinfo->value.integer.min = -(int)(acm8623->vol_count - 1);
+	uinfo->value.integer.max = acm8623->vol_count - 1;
+	return 0;
 }
 
-static int acm8623_trigger(struct snd_pcm_substream *substream, int cmd,
-			    struct snd_soc_dai *dai)
+static int acm8623_balance_get(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_value *ucontrol)
 {
-	struct snd_soc_component *component = dai->component;
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
 	struct acm8623_priv *acm8623 =
 		snd_soc_component_get_drvdata(component);
 
-	switch (cmd) {
-	case SNDRV_PCM_TRIGGER_START:
-	case SNDRV_PCM_TRIGGER_RESUME:
-	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
-		dev_dbg(component->dev, "clock start\n");
-		schedule_work(&acm8623->work);
-		break;
-
-	case SNDRV_PCM_TRIGGER_STOP:
-	case SNDRV_PCM_TRIGGER_SUSPEND:
-	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
-		break;
-
-	default:
-		return -EINVAL;
-	}
+	mutex_lock(&acm8623->lock);
+	ucontrol->value.integer.value[0] = acm8623->balance;
+	mutex_unlock(&acm8623->lock);
 
 	return 0;
 }
 
-static void do_work(struct work_struct *work)
+/* The balance is applied to the DSP scale of each channel, in steps of
+ * the volume, so only the channel it moves away from is written.
+ */
+static int acm8623_balance_put(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_value *ucontrol)
 {
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
 	struct acm8623_priv *acm8623 =
-	       container_of(work, struct acm8623_priv, work);
-	struct regmap *rm = acm8623->regmap;
+		snd_soc_component_get_drvdata(component);
+	long balance = ucontrol->value.integer.value[0];
+	int max = acm8623->vol_count - 1;
+	int old[2], ret = 0;
 
-	dev_dbg(&acm8623->i2c->dev, "DSP startup\n");
+	if (balance < -max || balance > max)
+		return -EINVAL;
 
 	mutex_lock(&acm8623->lock);
-	/* We mustn't issue any I2C transactions until the I2S
-	 * clock is stable. Furthermore, we must allow a 5ms
-	 * delay after the first set of register writes to
-	 * allow the DSP to boot before configuring it.
-	 */
-	usleep_range(5000, 10000);
-	send_cfg(rm, dsp_cfg_preboot, ARRAY_SIZE(dsp_cfg_preboot));
-	usleep_range(5000, 15000);
-	if (acm8623->dsp_cfg_data)
-		send_cfg(rm, acm8623->dsp_cfg_data, acm8623->dsp_cfg_len);
-	else
-		send_cfg(rm, dsp_cfg_default, ARRAY_SIZE(dsp_cfg_default));
-
-	acm8623->is_powered = true;
-	acm8623_refresh(acm8623);
+	if (acm8623->balance != balance) {
+		old[0] = acm8623_channel_vol(acm8623, 0);
+		old[1] = acm8623_channel_vol(acm8623, 1);
+		acm8623->balance = balance;
+		dev_dbg(component->dev, "set balance=%d (is_powered=%d)\n",
+			acm8623->balance, acm8623->is_powered);
+		ret = acm8623_update_channels(acm8623, old) ?: 1;
+	}
 	mutex_unlock(&acm8623->lock);
+
+	return ret;
 }
 
-static int acm8623_dac_event(struct snd_soc_dapm_widget *w,
-			      struct snd_kcontrol *kcontrol, int event)
+static int acm8623_fault_info(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_info *uinfo)
 {
-	struct snd_soc_component *component = snd_soc_dapm_to_component(w->dapm);
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_BYTES;
+	uinfo->count = ACM8623_FAULT_REGS;
+	return 0;
+}
+
+static int acm8623_fault_get(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
 	struct acm8623_priv *acm8623 =
 		snd_soc_component_get_drvdata(component);
-	struct regmap *rm = acm8623->regmap;
 
-	if (event & SND_SOC_DAPM_PRE_PMD) {
-		unsigned int channel_state, global1, global2, global3;
+	mutex_lock(&acm8623->lock);
+	memcpy(ucontrol->value.bytes.data, acm8623->fault,
+	       ACM8623_FAULT_REGS);
+	mutex_unlock(&acm8623->lock);
+
+	return 0;
+}
+
+static const struct snd_kcontrol_new acm8623_snd_controls[] = {
+	{
+		.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name	= "Master Playback Volume",
+		.access	= SNDRV_CTL_ELEM_ACCESS_TLV_READ |
+			  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK |
+			  SNDRV_CTL_ELEM_ACCESS_READWRITE,
+		.tlv.c	= acm8623_vol_tlv,
+		.info	= acm8623_vol_info,
+		.get	= acm8623_vol_get,
+		.put	= acm8623_vol_put,
+	},
+	{
+		.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name	= "Master Playback Balance",
+		.access	= SNDRV_CTL_ELEM_ACCESS_READWRITE,
+		.info	= acm8623_balance_info,
+		.get	= acm8623_balance_get,
+		.put	= acm8623_balance_put,
+	},
+	{
+		/* STATE_REPORT, GLOBAL_FAULT1..3 as last seen */
+		.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name	= "Fault Status",
+		.access	= SNDRV_CTL_ELEM_ACCESS_READ |
+			  SNDRV_CTL_ELEM_ACCESS_VOLATILE,
+		.info	= acm8623_fault_info,
+		.get	= acm8623_fault_get,
+	},
+};
+
+static int acm8623_group_vol_info(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_info *uinfo)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+
+	uinfo->value.integer.min = ACM8623_VOLUME_MIN;
+	uinfo->value.integer.max = acm8623->vol_count - 1;
+	return 0;
+}
+
+static int acm8623_group_vol_get(struct snd_kcontrol *kcontrol,
+				  struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	struct acm8623_group *group = acm8623->group;
+
+	mutex_lock(&group->lock);
+	ucontrol->value.integer.value[0] = group->vol;
+	mutex_unlock(&group->lock);
+
+	return 0;
+}
+
+/* Whether every member of the group scales by the same coefficients */
+static bool acm8623_group_vol_shared(struct acm8623_priv *acm8623)
+{
+	const struct acm8623_curve *vol = &acm8623_cfg(acm8623)->vol;
+	struct acm8623_priv *member;
+
+	list_for_each_entry(member, &acm8623->group->members, group_node)
+		if (!acm8623_curve_equal(&acm8623_cfg(member)->vol, vol) ||
+		    member->balance != acm8623->balance)
+			return false;
+
+	return true;
+}
+
+/* Apply one volume to every member of the group in a single pass. When
+ * all members are playing the same coefficients they are broadcast,
+ * otherwise only the powered members are written.
+ */
+static int acm8623_group_vol_put(struct snd_kcontrol *kcontrol,
+				  struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	struct acm8623_group *group = acm8623->group;
+	struct acm8623_priv *member;
+	int vol = ucontrol->value.integer.value[0];
+	int ret = 0, err = 0;
+
+	if (!volume_is_valid(acm8623, vol))
+		return -EINVAL;
+
+	mutex_lock(&group->lock);
+	if (group->vol == vol)
+		goto out;
+
+	group->vol = vol;
+	ret = 1;
+
+	list_for_each_entry(member, &group->members, group_node) {
+		mutex_lock(&member->lock);
+		member->vol[0] = vol;
+		member->vol[1] = vol;
+	}
+
+	dev_dbg(component->dev, "set group vol=%d (%d of %d active)\n",
+		vol, group->active, group->size);
+
+	if (group->active == group->size &&
+	    acm8623_group_vol_shared(acm8623)) {
+		err = acm8623_write_volume(acm8623, group->regmap,
+					   ACM8623_CHANNELS);
+	} else {
+		list_for_each_entry(member, &group->members, group_node)
+			if (member->is_powered)
+				err = acm8623_write_volume(member,
+						member->regmap,
+						ACM8623_CHANNELS) ?: err;
+	}
+	if (err)
+		ret = err;
+
+	list_for_each_entry(member, &group->members, group_node) {
+		mutex_unlock(&member->lock);
+		if (member->component)
+			snd_soc_component_notify_control(member->component,
+						"Master Playback Volume");
+	}
+out:
+	mutex_unlock(&group->lock);
+
+	return ret;
+}
+
+static const struct snd_kcontrol_new acm8623_group_controls[] = {
+	{
+		.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name	= "Group Playback Volume",
+		.access	= SNDRV_CTL_ELEM_ACCESS_TLV_READ |
+			  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK |
+			  SNDRV_CTL_ELEM_ACCESS_READWRITE,
+		.tlv.c	= acm8623_vol_tlv,
+		.info	= acm8623_group_vol_info,
+		.get	= acm8623_group_vol_get,
+		.put	= acm8623_group_vol_put,
+	},
+};
+
+/* One register write of a blob being compiled. order numbers the
+ * pages by first visit since the last write to page 0, seq keeps the
+ * position in the blob.
+ */
+struct acm8623_cfg_write {
+	u8						page;
+	u8						reg;
+	u8						val;
+	u8						order;
+	u32						seq;
+};
+
+static int acm8623_cfg_write_cmp(const void *a, const void *b)
+{
+	const struct acm8623_cfg_write *x = a, *y = b;
+
+	if (x->order != y->order)
+		return x->order - y->order;
+	if (x->reg != y->reg)
+		return x->reg - y->reg;
+
+	return x->seq < y->seq ? -1 : 1;
+}
+
+/* Gather the writes between two writes to page 0 per page, sorted by
+ * register, keeping only the last write to each register. Returns the
+ * number of writes left.
+ */
+static unsigned int acm8623_compile_run(struct acm8623_cfg_write *w,
+					 unsigned int n)
+{
+	unsigned int i, out = 0;
+
+	sort(w, n, sizeof(*w), acm8623_cfg_write_cmp, NULL);
+
+	for (i = 0; i < n; i++)
+		if (i + 1 == n || w[i].order != w[i + 1].order ||
+		    w[i].reg != w[i + 1].reg)
+			w[out++] = w[i];
+
+	return out;
+}
+
+/* Compile a blob of (register, value) pairs into segments. Writes to
+ * page 0 reach control and status registers and may have side effects,
+ * so they keep their order and go out one at a time. The other pages
+ * hold DSP coefficients: between two writes to page 0 their writes are
+ * deduplicated and sorted, so each run of consecutive registers takes
+ * one bulk write.
+ */
+static int acm8623_compile(const uint8_t *s, unsigned int len,
+			    struct acm8623_cfg *cfg)
+{
+	struct acm8623_cfg_write *w;
+	struct acm8623_seg *seg = NULL;
+	u8 order[ACM8623_PAGES] = { 0 };
+	unsigned int i, n = 0, start, out = 0;
+	u8 page = 0, next = 0;
+
+	w = kmalloc_array(len / 2 ?: 1, sizeof(*w), GFP_KERNEL);
+	if (!w)
+		return -ENOMEM;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		if (s[i] == REG_PAGE) {
+			page = s[i + 1];
+			continue;
+		}
+
+		if (!page) {
+			memset(order, 0, sizeof(order));
+			next = 0;
+		} else if (!order[page]) {
+			order[page] = ++next;
+		}
+
+		w[n].page = page;
+		w[n].reg = s[i];
+		w[n].val = s[i + 1];
+		w[n].order = order[page];
+		w[n].seq = n;
+		n++;
+	}
+
+	for (i = 0; i < n; ) {
+		if (!w[i].page) {
+			w[out++] = w[i++];
+			continue;
+		}
+
+		for (start = i; i < n && w[i].page; i++)
+			;
+		memmove(&w[out], &w[start], (i - start) * sizeof(*w));
+		out += acm8623_compile_run(&w[out], i - start);
+	}
+	n = out;
+
+	cfg->segs = kcalloc(n ?: 1, sizeof(*cfg->segs), GFP_KERNEL);
+	cfg->data = kmalloc(n ?: 1, GFP_KERNEL);
+	if (!cfg->segs || !cfg->data) {
+		kfree(w);
+		return -ENOMEM;
+	}
+
+	cfg->num_segs = 0;
+	for (i = 0; i < n; i++) {
+		cfg->data[i] = w[i].val;
+
+		if (seg && w[i].page && seg->page == w[i].page &&
+		    seg->reg + seg->len == w[i].reg) {
+			seg->len++;
+			continue;
+		}
+
+		seg = &cfg->segs[cfg->num_segs++];
+		seg->page = w[i].page;
+		seg->reg = w[i].reg;
+		seg->len = 1;
+		seg->offset = i;
+	}
+	cfg->len = n;
+	cfg->end_page = page;
+
+	kfree(w);
+
+	return 0;
+}
+
+static bool acm8623_cfg_equal(const struct acm8623_cfg *a,
+			       const struct acm8623_cfg *b)
+{
+	return a->num_segs == b->num_segs && a->len == b->len &&
+	       a->end_page == b->end_page &&
+	       !memcmp(a->segs, b->segs, a->num_segs * sizeof(*a->segs)) &&
+	       !memcmp(a->data, b->data, a->len) &&
+	       acm8623_curve_equal(&a->vol, &b->vol);
+}
+
+static bool acm8623_profiles_equal(struct acm8623_priv *a,
+				    struct acm8623_priv *b)
+{
+	unsigned int i;
+
+	if (a->num_profiles != b->num_profiles)
+		return false;
+
+	for (i = 0; i < a->num_profiles; i++)
+		if (!acm8623_cfg_equal(&a->profiles[i], &b->profiles[i]))
+			return false;
+
+	return true;
+}
+
+static struct acm8623_shadow *acm8623_shadow_page(
+		struct acm8623_priv *acm8623, unsigned int page)
+{
+	unsigned int i;
+
+	for (i = 0; i < acm8623->num_shadow; i++)
+		if (acm8623->shadow[i].page == page)
+			return &acm8623->shadow[i];
+
+	return NULL;
+}
+
+/* Record a write to a DSP page. A write that failed may have partly
+ * landed, so the registers it covers are no longer known.
+ */
+static void acm8623_shadow_store(struct acm8623_priv *acm8623,
+				  unsigned int page, unsigned int reg,
+				  const u8 *val, unsigned int len, int err)
+{
+	struct acm8623_shadow *sh = acm8623_shadow_page(acm8623, page);
+
+	if (!sh)
+		return;
+
+	if (err) {
+		bitmap_clear(sh->valid, reg, len);
+		return;
+	}
+
+	memcpy(&sh->val[reg], val, len);
+	bitmap_set(sh->valid, reg, len);
+}
+
+/* After a reboot of the DSP nothing is known */
+static void acm8623_shadow_reset(struct acm8623_priv *acm8623)
+{
+	unsigned int i;
+
+	for (i = 0; i < acm8623->num_shadow; i++)
+		bitmap_zero(acm8623->shadow[i].valid, ACM8623_PAGE_SIZE);
+}
+
+/* Take over what another instance knows, for the pages both track */
+static void acm8623_shadow_copy(struct acm8623_priv *dst,
+				 struct acm8623_priv *src)
+{
+	struct acm8623_shadow *sh;
+	unsigned int i;
+
+	for (i = 0; i < dst->num_shadow; i++) {
+		sh = acm8623_shadow_page(src, dst->shadow[i].page);
+		if (sh)
+			dst->shadow[i] = *sh;
+		else
+			bitmap_zero(dst->shadow[i].valid, ACM8623_PAGE_SIZE);
+	}
+}
+
+static int acm8623_write_seg(struct acm8623_priv *acm8623,
+			      struct regmap *rm, const struct acm8623_cfg *cfg,
+			      const struct acm8623_seg *seg)
+{
+	const u8 *val = &cfg->data[seg->offset];
+	int ret;
+
+	if (seg->len == 1)
+		ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG, seg->reg,
+				     *val);
+	else
+		ret = acm8623_bulk_write(acm8623, rm, ACM8623_IO_CFG,
+					  seg->reg, val, seg->len);
+
+	if (seg->page)
+		acm8623_shadow_store(acm8623, seg->page, seg->reg, val,
+				      seg->len, ret);
+
+	return ret;
+}
+
+/* The stock blob ends by switching to PLAY. An amplifier on a link is
+ * started together with its peers by acm8623_link_play(), so the
+ * blob only takes it as far as Hi-Z.
+ */
+static bool acm8623_seg_plays(struct acm8623_priv *acm8623,
+			       const struct acm8623_cfg *cfg,
+			       const struct acm8623_seg *seg)
+{
+	return acm8623->link && !seg->page && seg->reg == REG_DEVICE_STATE &&
+	       (cfg->data[seg->offset] & ~DEVICE_STATE_MUTE) ==
+	       DEVICE_STATE_PLAY;
+}
+
+/* A write that fails after its own retries resumes the upload from
+ * the page select that started its run of segments, so the registers
+ * of that page are written again in order. The page is selected
+ * before the first segment, whatever an earlier access left behind,
+ * and an upload that gives up returns the chip to page 0.
+ */
+static int send_cfg(struct acm8623_priv *acm8623, struct regmap *rm,
+		    const struct acm8623_cfg *cfg)
+{
+	const struct acm8623_seg *seg;
+	unsigned int i = 0, first = 0;
+	int page = -1, ret = 0, tries = 0;
+
+	while (i < cfg->num_segs) {
+		seg = &cfg->segs[i];
+		if (seg->page != page) {
+			if (i != first) {
+				first = i;
+				tries = 0;
+			}
+
+			ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG,
+					     REG_PAGE, seg->page);
+			if (!ret)
+				page = seg->page;
+		}
+
+		if (!ret && acm8623_seg_plays(acm8623, cfg, seg))
+			ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG,
+					     REG_DEVICE_STATE, DEVICE_STATE_HIZ);
+		else if (!ret)
+			ret = acm8623_write_seg(acm8623, rm, cfg, seg);
+		if (!ret) {
+			i++;
+			continue;
+		}
+
+		if (tries++ == ACM8623_SEGMENT_RETRIES) {
+			acm8623->cfg_fail_reg = seg->page << 8 | seg->reg;
+			dev_err(&acm8623->i2c->dev,
+				"config write failed at page %02x reg %02x: %d\n",
+				seg->page, seg->reg, ret);
+			acm8623_write(acm8623, rm, ACM8623_IO_CFG, REG_PAGE,
+				       0x00);
+			return ret;
+		}
+
+		acm8623->stats.segment_retries++;
+		i = first;
+		page = -1;
+	}
+
+	if (page != cfg->end_page)
+		ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG, REG_PAGE,
+				     cfg->end_page);
+
+	return ret;
+}
+
+static int acm8623_upload(struct acm8623_priv *acm8623, struct regmap *rm)
+{
+	int ret;
+
+	acm8623->cfg_fail_reg = -1;
+	ret = send_cfg(acm8623, rm, &acm8623->preboot);
+	if (ret)
+		return ret;
+
+	usleep_range(5000, 15000);
+	acm8623_shadow_reset(acm8623);
+
+	return send_cfg(acm8623, rm, acm8623_cfg(acm8623));
+}
+
+/* What the blob leaves in one page: the last value written to each
+ * register, and which registers were written at all.
+ */
+static void acm8623_cfg_page(const struct acm8623_cfg *cfg,
+			      unsigned int page, u8 *val,
+			      unsigned long *written)
+{
+	const struct acm8623_seg *seg;
+	unsigned int i;
+
+	bitmap_zero(written, ACM8623_PAGE_SIZE);
+	for (seg = cfg->segs; seg < cfg->segs + cfg->num_segs; seg++) {
+		if (seg->page != page)
+			continue;
+
+		for (i = 0; i < seg->len; i++)
+			val[seg->reg + i] = cfg->data[seg->offset + i];
+		bitmap_set(written, seg->reg, seg->len);
+	}
+}
+
+/* The DSP pages a blob writes, page 0 left out */
+static void acm8623_cfg_pages(const struct acm8623_cfg *cfg,
+			       unsigned long *pages)
+{
+	unsigned int i;
+
+	bitmap_zero(pages, ACM8623_PAGES);
+	for (i = 0; i < cfg->num_segs; i++)
+		if (cfg->segs[i].page)
+			__set_bit(cfg->segs[i].page, pages);
+}
+
+/* Compare one page against the blob with a single bulk read covering
+ * the written registers. Returns 1 on mismatch.
+ */
+static int acm8623_verify_page(struct acm8623_priv *acm8623,
+				unsigned int page)
+{
+	u8 expect[ACM8623_PAGE_SIZE], actual[ACM8623_PAGE_SIZE];
+	DECLARE_BITMAP(written, ACM8623_PAGE_SIZE);
+	unsigned int first, last, reg;
+	int ret;
+
+	acm8623_cfg_page(acm8623_cfg(acm8623), page, expect, written);
+	first = find_first_bit(written, ACM8623_PAGE_SIZE);
+	if (first >= ACM8623_PAGE_SIZE)
+		return 0;
+	last = find_last_bit(written, ACM8623_PAGE_SIZE);
+
+	ret = acm8623_write(acm8623, acm8623->regmap, ACM8623_IO_CFG,
+			     REG_PAGE, page);
+	if (!ret)
+		ret = acm8623_bulk_read(acm8623, ACM8623_IO_CFG, first,
+					 actual + first, last - first + 1);
+	if (ret)
+		return ret;
+
+	acm8623->stats.verified_pages++;
+
+	/* Registers the blob leaves alone may read back anything */
+	for_each_set_bit(reg, written, ACM8623_PAGE_SIZE)
+		if (actual[reg] != expect[reg])
+			return 1;
+
+	return 0;
+}
+
+/* Replay only the segments that target one page */
+static int acm8623_rewrite_page(struct acm8623_priv *acm8623,
+				 unsigned int page)
+{
+	const struct acm8623_cfg *cfg = acm8623_cfg(acm8623);
+	struct regmap *rm = acm8623->regmap;
+	const struct acm8623_seg *seg;
+	int ret;
+
+	ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG, REG_PAGE, page);
+	for (seg = cfg->segs; !ret && seg < cfg->segs + cfg->num_segs; seg++)
+		if (seg->page == page)
+			ret = acm8623_write_seg(acm8623, rm, cfg, seg);
+
+	return ret;
+}
+
+/* Read back the pages the tuning blob wrote, all of them or a random
+ * sample, and rewrite the ones that did not land. Page 0 holds
+ * control and status registers that change on their own; skip it.
+ */
+static int acm8623_verify_cfg(struct acm8623_priv *acm8623)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	DECLARE_BITMAP(pages, ACM8623_PAGES);
+	unsigned int page, n;
+	int ret = 0, err;
+
+	acm8623_cfg_pages(acm8623_cfg(acm8623), pages);
+
+	n = bitmap_weight(pages, ACM8623_PAGES);
+	for_each_set_bit(page, pages, ACM8623_PAGES) {
+		if (verify == 1 &&
+		    get_random_u32() % n >= ACM8623_VERIFY_SAMPLE)
+			continue;
+
+		ret = acm8623_verify_page(acm8623, page);
+		if (ret < 0)
+			break;
+		if (!ret)
+			continue;
+
+		dev_warn(dev, "config page %02x did not land, rewriting\n",
+			 page);
+		acm8623->stats.verify_mismatches++;
+
+		ret = acm8623_rewrite_page(acm8623, page);
+		if (!ret)
+			ret = acm8623_verify_page(acm8623, page);
+		if (ret > 0) {
+			acm8623->stats.verify_failures++;
+			ret = -EIO;
+		}
+		if (ret)
+			break;
+	}
+
+	err = acm8623_write(acm8623, acm8623->regmap, ACM8623_IO_CFG,
+			     REG_PAGE, 0x00);
+
+	return ret ?: err;
+}
+
+/* A blob can be applied in place of another one if both write the same
+ * page 0 sequence, and it sets every DSP register whose value is known
+ * from the other one. Otherwise registers would keep values of the old
+ * blob.
+ */
+static bool acm8623_can_switch(struct acm8623_priv *acm8623,
+				const struct acm8623_cfg *from,
+				const struct acm8623_cfg *to)
+{
+	const struct acm8623_seg *a = from->segs, *a_end = a + from->num_segs;
+	const struct acm8623_seg *b = to->segs, *b_end = b + to->num_segs;
+	DECLARE_BITMAP(written, ACM8623_PAGE_SIZE);
+	struct acm8623_shadow *sh;
+	u8 val[ACM8623_PAGE_SIZE];
+
+	/* Page 0 writes are compiled one register per segment */
+	for (;;) {
+		while (a < a_end && a->page)
+			a++;
+		while (b < b_end && b->page)
+			b++;
+		if (a == a_end || b == b_end)
+			break;
+		if (a->reg != b->reg ||
+		    from->data[a->offset] != to->data[b->offset])
+			return false;
+		a++;
+		b++;
+	}
+	if (a != a_end || b != b_end)
+		return false;
+
+	for (sh = acm8623->shadow;
+	     sh < acm8623->shadow + acm8623->num_shadow; sh++) {
+		acm8623_cfg_page(to, sh->page, val, written);
+		if (!bitmap_subset(sh->valid, written, ACM8623_PAGE_SIZE))
+			return false;
+	}
+
+	return true;
+}
+
+/* Write the DSP registers of a blob whose last written value differs
+ * or is not known. Runs of them that are close together go out as one
+ * bulk write, together with the unchanged registers between them.
+ */
+static int acm8623_write_delta(struct acm8623_priv *acm8623,
+				const struct acm8623_cfg *to)
+{
+	struct regmap *rm = acm8623->regmap;
+	u8 new[ACM8623_PAGE_SIZE];
+	DECLARE_BITMAP(written, ACM8623_PAGE_SIZE);
+	DECLARE_BITMAP(changed, ACM8623_PAGE_SIZE);
+	DECLARE_BITMAP(pages, ACM8623_PAGES);
+	struct acm8623_shadow *sh;
+	unsigned int page, reg, end, next, n;
+	bool paged = false;
+	int ret = 0, err;
+
+	acm8623->stats.delta_updates++;
+
+	acm8623_cfg_pages(to, pages);
+	for_each_set_bit(page, pages, ACM8623_PAGES) {
+		sh = acm8623_shadow_page(acm8623, page);
+		acm8623_cfg_page(to, page, new, written);
+
+		bitmap_zero(changed, ACM8623_PAGE_SIZE);
+		for_each_set_bit(reg, written, ACM8623_PAGE_SIZE)
+			if (!sh || !test_bit(reg, sh->valid) ||
+			    sh->val[reg] != new[reg])
+				__set_bit(reg, changed);
+
+		n = bitmap_weight(changed, ACM8623_PAGE_SIZE);
+		acm8623->stats.delta_regs += n;
+		acm8623->stats.delta_skipped +=
+			bitmap_weight(written, ACM8623_PAGE_SIZE) - n;
+		if (!n)
+			continue;
+
+		ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG, REG_PAGE,
+				     page);
+		paged = true;
+
+		reg = find_first_bit(changed, ACM8623_PAGE_SIZE);
+		while (!ret && reg < ACM8623_PAGE_SIZE) {
+			end = reg + 1;
+			for (;;) {
+				next = find_next_bit(changed, ACM8623_PAGE_SIZE,
+						     end);
+				if (next >= ACM8623_PAGE_SIZE ||
+				    next - end > ACM8623_DELTA_GAP ||
+				    find_next_zero_bit(written,
+						       ACM8623_PAGE_SIZE,
+						       end) < next)
+					break;
+				end = next + 1;
+			}
+
+			if (end - reg == 1)
+				ret = acm8623_write(acm8623, rm,
+						     ACM8623_IO_CFG, reg,
+						     new[reg]);
+			else
+				ret = acm8623_bulk_write(acm8623, rm,
+							  ACM8623_IO_CFG, reg,
+							  &new[reg],
+							  end - reg);
+			acm8623_shadow_store(acm8623, page, reg, &new[reg],
+					      end - reg, ret);
+
+			reg = find_next_bit(changed, ACM8623_PAGE_SIZE, end);
+		}
+		if (ret)
+			break;
+	}
+
+	if (!paged)
+		return 0;
+
+	err = acm8623_write(acm8623, rm, ACM8623_IO_CFG, REG_PAGE, 0x00);
+
+	return ret ?: err;
+}
+
+/* Put the active profile in place of another blob. A powered amplifier
+ * gets the registers that differ written in place; if that is not
+ * possible, or it is not powered, the profile is uploaded on the next
+ * stream start. Called with lock held, and group->lock if in a group.
+ */
+static int acm8623_apply_profile(struct acm8623_priv *acm8623,
+				  const struct acm8623_cfg *from)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	const struct acm8623_cfg *to = acm8623_cfg(acm8623);
+	const char *name = acm8623->profile_names[acm8623->profile];
+	int ret;
+
+	if (!acm8623->is_powered || acm8623->failed) {
+		acm8623->cfg_valid = false;
+		return 0;
+	}
+
+	if (!acm8623_can_switch(acm8623, from, to)) {
+		dev_info(dev, "profile %s applies from the next stream start\n",
+			 name);
+		acm8623->cfg_valid = false;
+		return 0;
+	}
+
+	dev_dbg(dev, "apply profile %s\n", name);
+
+	/* A blob may set the volume coefficients too, so put the
+	 * control's volume back. They are why there is no verify here.
+	 */
+	ret = acm8623_write_delta(acm8623, to);
+	if (!ret)
+		ret = acm8623_write_volume(acm8623, acm8623->regmap,
+					   ACM8623_CHANNELS);
+
+	/* The profile is not known to be in place; upload it in full */
+	if (ret)
+		acm8623->cfg_valid = false;
+
+	return ret;
+}
+
+static int acm8623_set_profile(struct acm8623_priv *acm8623,
+				unsigned int profile)
+{
+	const struct acm8623_cfg *from = acm8623_cfg(acm8623);
+
+	acm8623->profile = profile;
+
+	return acm8623_apply_profile(acm8623, from);
+}
+
+/* Broadcast the shared configuration to every group member at once.
+ * Returns true if this instance is configured and only needs its
+ * per-device settings. Called with group->lock held.
+ */
+static bool acm8623_group_send_cfg(struct acm8623_priv *acm8623)
+{
+	struct acm8623_group *group = acm8623->group;
+	struct acm8623_priv *member;
+	int ret;
+
+	if (!group)
+		return false;
+
+	if (acm8623->cfg_valid)
+		return true;
+
+	/* A broadcast would reboot the members that are playing */
+	if (group->active)
+		return false;
+
+	dev_dbg(&acm8623->i2c->dev, "broadcast config to group 0x%02x\n",
+		group->client->addr);
+
+	ret = acm8623_upload(acm8623, group->regmap);
+
+	/* Park everyone. Members that are streaming switch to PLAY
+	 * in their own refresh.
+	 */
+	if (!ret)
+		ret = acm8623_write(acm8623, group->regmap, ACM8623_IO_CFG,
+				     REG_PAGE, 0x00);
+	if (!ret)
+		ret = acm8623_write(acm8623, group->regmap, ACM8623_IO_CFG,
+				     REG_DEVICE_STATE, DEVICE_STATE_HIZ);
+
+	/* Nobody acknowledged it all; fall back to individual uploads */
+	if (ret)
+		return false;
+
+	/* Members that run another profile, or reloaded theirs, still
+	 * need their own upload
+	 */
+	list_for_each_entry(member, &group->members, group_node) {
+		member->cfg_valid = acm8623_cfg_equal(acm8623_cfg(member),
+						       acm8623_cfg(acm8623));
+		if (member != acm8623)
+			acm8623_shadow_copy(member, acm8623);
+	}
+
+	return true;
+}
+
+static int acm8623_apply_fmt(struct acm8623_priv *acm8623)
+{
+	struct regmap *rm = acm8623->regmap;
+	int ret;
+
+	if (!acm8623->has_fmt)
+		return 0;
+
+	ret = acm8623_write(acm8623, rm, ACM8623_IO_CFG, REG_PAGE, 0x00);
+	if (!ret)
+		ret = acm8623_update_bits(acm8623, ACM8623_IO_CFG,
+					   REG_SAP_CTRL1, SAP_FMT_MASK,
+					   acm8623->sap_ctrl1);
+	if (!ret)
+		ret = acm8623_update_bits(acm8623, ACM8623_IO_CFG,
+					   REG_SAP_CTRL2, SAP_CTRL2_MASK,
+					   acm8623->sap_ctrl2);
+
+	return ret;
+}
+
+static int acm8623_set_fmt(struct snd_soc_dai *dai, unsigned int fmt)
+{
+	struct snd_soc_component *component = dai->component;
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	uint8_t ctrl1, ctrl2 = 0;
+
+	/* The amplifier is always clock consumer */
+	if ((fmt & SND_SOC_DAIFMT_CLOCK_PROVIDER_MASK) !=
+	    SND_SOC_DAIFMT_CBC_CFC) {
+		dev_err(component->dev, "unsupported clock provider: %#x\n",
+			fmt & SND_SOC_DAIFMT_CLOCK_PROVIDER_MASK);
+		return -EINVAL;
+	}
+
+	switch (fmt & SND_SOC_DAIFMT_FORMAT_MASK) {
+	case SND_SOC_DAIFMT_I2S:
+		ctrl1 = SAP_FMT_I2S;
+		break;
+	case SND_SOC_DAIFMT_LEFT_J:
+		ctrl1 = SAP_FMT_LEFT_J;
+		break;
+	case SND_SOC_DAIFMT_DSP_A:
+		/* Short frame sync, MSB one BCLK after the sync pulse */
+		ctrl1 = SAP_FMT_DSP;
+		ctrl2 |= SAP_DATA_OFFSET_1;
+		break;
+	case SND_SOC_DAIFMT_DSP_B:
+		ctrl1 = SAP_FMT_DSP;
+		break;
+	default:
+		dev_err(component->dev, "unsupported DAI format: %#x\n",
+			fmt & SND_SOC_DAIFMT_FORMAT_MASK);
+		return -EINVAL;
+	}
+
+	switch (fmt & SND_SOC_DAIFMT_INV_MASK) {
+	case SND_SOC_DAIFMT_NB_NF:
+		break;
+	case SND_SOC_DAIFMT_IB_NF:
+		ctrl2 |= SAP_BCLK_INV;
+		break;
+	case SND_SOC_DAIFMT_NB_IF:
+		ctrl2 |= SAP_LRCLK_INV;
+		break;
+	case SND_SOC_DAIFMT_IB_IF:
+		ctrl2 |= SAP_BCLK_INV | SAP_LRCLK_INV;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	dev_dbg(component->dev, "set fmt: SAP_CTRL1=%02x, SAP_CTRL2=%02x\n",
+		ctrl1, ctrl2);
+
+	/* The format only takes effect on the next DSP startup, after
+	 * the tuning blob has been replayed.
+	 */
+	mutex_lock(&acm8623->lock);
+	acm8623->has_fmt = true;
+	acm8623->sap_ctrl1 = ctrl1;
+	acm8623->sap_ctrl2 = ctrl2;
+	mutex_unlock(&acm8623->lock);
+
+	return 0;
+}
+
+static int acm8623_trigger(struct snd_pcm_substream *substream, int cmd,
+			    struct snd_soc_dai *dai)
+{
+	struct snd_soc_component *component = dai->component;
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_RESUME:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		dev_dbg(component->dev, "clock start\n");
+		acm8623->trigger_time = ktime_get();
+		/* Unbound, so amplifiers on separate buses boot in
+		 * parallel rather than behind each other.
+		 */
+		queue_work(system_unbound_wq, &acm8623->work);
+		break;
+
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Switch every instance that arrived on the link to PLAY, with one
+ * broadcast write if they make up a whole group or back to back
+ * otherwise, and record the skew between the first and last of them
+ * to enter PLAY. Instances that are no longer pending, because their
+ * volume write failed or a fault recovery switched them off, are
+ * left alone.
+ *
+ * Called with link->lock held by the last instance to arrive, and no
+ * other lock. Each instance is locked for its own PLAY write only; a
+ * broadcast takes the group lock and all of them.
+ */
+static void acm8623_link_play(struct acm8623_link *link)
+{
+	struct acm8623_priv *first, *member;
+	struct acm8623_group *group;
+	ktime_t t_first = 0, t_last = 0;
+	bool broadcast = true;
+	int count = 0;
+	s64 skew;
+
+	first = list_first_entry(&link->arrived, struct acm8623_priv,
+				 link_node);
+	group = first->group;
+
+	list_for_each_entry(member, &link->arrived, link_node) {
+		if (member->group != group ||
+		    member->is_muted != first->is_muted)
+			broadcast = false;
+		count++;
+	}
+	if (!group || count != READ_ONCE(group->size))
+		broadcast = false;
+
+	/* Only a PLAY write that went through counts. Instances whose
+	 * write failed are left unsynced and try again on their own.
+	 */
+	if (broadcast) {
+		mutex_lock(&group->lock);
+		list_for_each_entry(member, &link->arrived, link_node) {
+			mutex_lock(&member->lock);
+			if (!member->link_pending ||
+			    member->is_muted != first->is_muted)
+				broadcast = false;
+		}
+
+		if (broadcast &&
+		    !acm8623_write(first, group->regmap, ACM8623_IO_REFRESH,
+				    REG_DEVICE_STATE,
+				    acm8623_play_state(first))) {
+			t_first = t_last = ktime_get();
+			list_for_each_entry(member, &link->arrived, link_node) {
+				member->play_time = t_last;
+				member->link_pending = false;
+				member->link_synced = true;
+			}
+		}
+
+		list_for_each_entry(member, &link->arrived, link_node)
+			mutex_unlock(&member->lock);
+		mutex_unlock(&group->lock);
+	}
+
+	if (!broadcast) {
+		list_for_each_entry(member, &link->arrived, link_node) {
+			mutex_lock(&member->lock);
+			if (member->link_pending &&
+			    !acm8623_write(member, member->regmap,
+					    ACM8623_IO_REFRESH,
+					    REG_DEVICE_STATE,
+					    acm8623_play_state(member))) {
+				member->play_time = t_last = ktime_get();
+				member->link_pending = false;
+				member->link_synced = true;
+				if (!t_first)
+					t_first = t_last;
+			}
+			mutex_unlock(&member->lock);
+		}
+	}
+	skew = ktime_to_ns(ktime_sub(t_last, t_first));
+
+	list_for_each_entry(member, &link->arrived, link_node) {
+		mutex_lock(&member->lock);
+		member->link_skew_ns = skew;
+		mutex_unlock(&member->lock);
+	}
+
+	dev_dbg(&first->i2c->dev, "link start: %d amplifiers%s, skew %lld ns\n",
+		count, broadcast ? " (broadcast)" : "", skew);
+}
+
+static void acm8623_link_release(struct acm8623_link *link)
+{
+	link->ready = 0;
+	INIT_LIST_HEAD(&link->arrived);
+	link->gen++;
+}
+
+/* Wait until every instance on the DAI link has been configured, then
+ * start them together. Called without the instance lock, so nothing
+ * that needs it waits on the peers. Returns true if PLAY has already
+ * been written for this instance.
+ */
+static bool acm8623_link_start(struct acm8623_priv *acm8623)
+{
+	struct acm8623_link *link = acm8623->link;
+	unsigned int gen;
+	bool synced;
+	long left;
+
+	mutex_lock(&link->lock);
+	gen = link->gen;
+	acm8623->link_synced = false;
+	list_add_tail(&acm8623->link_node, &link->arrived);
+	if (++link->ready == link->members) {
+		acm8623_link_play(link);
+		acm8623_link_release(link);
+		mutex_unlock(&link->lock);
+		wake_up_all(&link->wq);
+		return true;
+	}
+	mutex_unlock(&link->lock);
+
+	left = wait_event_timeout(link->wq, READ_ONCE(link->gen) != gen,
+			msecs_to_jiffies(ACM8623_LINK_TIMEOUT_MS));
+	if (!left) {
+		/* A peer never showed up; release everyone rather than
+		 * keeping the whole link silent. Each instance then
+		 * starts on its own.
+		 */
+		dev_warn(&acm8623->i2c->dev,
+			 "timed out waiting for link peers\n");
+		mutex_lock(&link->lock);
+		if (link->gen == gen)
+			acm8623_link_release(link);
+		mutex_unlock(&link->lock);
+		wake_up_all(&link->wq);
+	}
+
+	mutex_lock(&link->lock);
+	synced = acm8623->link_synced;
+	mutex_unlock(&link->lock);
+
+	return synced;
+}
+
+static int acm8623_read_faults(struct acm8623_priv *acm8623, u8 *fault)
+{
+	return acm8623_bulk_read(acm8623, ACM8623_IO_CTRL, REG_STATE_REPORT,
+				  fault, ACM8623_FAULT_REGS);
+}
+
+static bool acm8623_faulted(const u8 *fault)
+{
+	return fault[1] || fault[2] || fault[3];
+}
+
+/* Read the fault registers and log any change. Returns true if
+ * userspace should be told. Called with the lock held.
+ */
+static bool acm8623_check_faults(struct acm8623_priv *acm8623)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	u8 fault[ACM8623_FAULT_REGS];
+
+	if (acm8623_read_faults(acm8623, fault))
+		return false;
+
+	if (!memcmp(fault, acm8623->fault, sizeof(fault)))
+		return false;
+
+	if (acm8623_faulted(fault)) {
+		acm8623->stats.faults++;
+		dev_warn(dev, "fault: CHANNEL=%02x, GLOBAL1=%02x, "
+			 "GLOBAL2=%02x, GLOBAL3=%02x\n",
+			 fault[0], fault[1], fault[2], fault[3]);
+	} else if (acm8623_faulted(acm8623->fault)) {
+		dev_info(dev, "fault cleared\n");
+	}
+	memcpy(acm8623->fault, fault, sizeof(fault));
+
+	return true;
+}
+
+static void acm8623_fault_notify(struct acm8623_priv *acm8623)
+{
+	if (acm8623->component)
+		snd_soc_component_notify_control(acm8623->component,
+						 "Fault Status");
+}
+
+static void acm8623_fault_lock(struct acm8623_priv *acm8623)
+{
+	/* Group broadcasts switch our page without our own lock */
+	if (acm8623->group)
+		mutex_lock(&acm8623->group->lock);
+	mutex_lock(&acm8623->lock);
+}
+
+static void acm8623_fault_unlock(struct acm8623_priv *acm8623)
+{
+	mutex_unlock(&acm8623->lock);
+	if (acm8623->group)
+		mutex_unlock(&acm8623->group->lock);
+}
+
+static void acm8623_set_failed(struct acm8623_priv *acm8623, int err)
+{
+	dev_err(&acm8623->i2c->dev, "DSP startup failed: %d\n", err);
+	acm8623->failed = true;
+	acm8623->stats.failures++;
+}
+
+/* Bring a faulted amplifier back to PLAY without a stream restart.
+ * Returns false if the attempt was rate limited.
+ */
+static bool acm8623_recover(struct acm8623_priv *acm8623)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	struct regmap *rm = acm8623->regmap;
+	ktime_t now = ktime_get();
+	s64 since;
+	int ret;
+
+	if (acm8623->recovery_time) {
+		since = ktime_ms_delta(now, acm8623->recovery_time);
+		if (since < ACM8623_RECOVERY_INTERVAL_MS)
+			return false;
+		if (since > ACM8623_RECOVERY_QUIET_MS)
+			acm8623->recovery_count = 0;
+	}
+	acm8623->recovery_time = now;
+	acm8623->stats.recoveries++;
+
+	acm8623_write(acm8623, rm, ACM8623_IO_CTRL, REG_DEVICE_STATE,
+		       DEVICE_STATE_HIZ);
+
+	if (++acm8623->recovery_count > ACM8623_RECOVERY_RETRIES) {
+		dev_warn(dev, "fault persists, resending DSP config\n");
+		acm8623->stats.reconfigs++;
+		acm8623->recovery_count = 0;
+
+		ret = acm8623_upload(acm8623, rm);
+		if (ret) {
+			/* As after a failed startup, a half-loaded DSP
+			 * stays off until the next stream start.
+			 */
+			acm8623_set_failed(acm8623, ret);
+			acm8623->is_powered = false;
+			acm8623->cfg_valid = false;
+			if (acm8623->group)
+				acm8623->group->active--;
+			return true;
+		}
+	} else {
+		dev_info(dev, "recovering from fault\n");
+	}
+
+	if (!acm8623_apply_fmt(acm8623))
+		acm8623_refresh(acm8623);
+
+	return true;
+}
+
+/* Check for faults and try to recover from them while playing.
+ * Called with the lock held.
+ */
+static bool acm8623_handle_faults(struct acm8623_priv *acm8623)
+{
+	bool changed = acm8623_check_faults(acm8623);
+
+	if (acm8623->is_powered && acm8623_faulted(acm8623->fault) &&
+	    acm8623_recover(acm8623))
+		changed |= acm8623_check_faults(acm8623);
+
+	return changed;
+}
+
+static irqreturn_t acm8623_fault_irq(int irq, void *data)
+{
+	struct acm8623_priv *acm8623 = data;
+	bool changed;
+
+	acm8623_fault_lock(acm8623);
+	changed = acm8623_handle_faults(acm8623);
+	/* No new edge comes while the fault is held, so poll until the
+	 * amplifier has recovered.
+	 */
+	if (acm8623->is_powered && acm8623_faulted(acm8623->fault)) {
+		acm8623->fault_poll_ms = ACM8623_FAULT_POLL_MIN_MS;
+		mod_delayed_work(system_power_efficient_wq,
+				 &acm8623->fault_work,
+				 msecs_to_jiffies(acm8623->fault_poll_ms));
+	}
+	acm8623_fault_unlock(acm8623);
+
+	if (changed)
+		acm8623_fault_notify(acm8623);
+
+	return IRQ_HANDLED;
+}
+
+static void acm8623_fault_poll(struct work_struct *work)
+{
+	struct acm8623_priv *acm8623 =
+	       container_of(to_delayed_work(work), struct acm8623_priv,
+			    fault_work);
+	bool changed, faulted;
+
+	acm8623_fault_lock(acm8623);
+	if (!acm8623->is_powered) {
+		acm8623_fault_unlock(acm8623);
+		return;
+	}
+
+	changed = acm8623_handle_faults(acm8623);
+	faulted = acm8623_faulted(acm8623->fault);
+	if (changed || faulted)
+		acm8623->fault_poll_ms = ACM8623_FAULT_POLL_MIN_MS;
+	else
+		acm8623->fault_poll_ms = min_t(unsigned int,
+						 acm8623->fault_poll_ms * 2,
+						 ACM8623_FAULT_POLL_MAX_MS);
+
+	if (!acm8623->fault_irq || faulted)
+		queue_delayed_work(system_power_efficient_wq,
+				   &acm8623->fault_work,
+				   msecs_to_jiffies(acm8623->fault_poll_ms));
+	acm8623_fault_unlock(acm8623);
+
+	if (changed)
+		acm8623_fault_notify(acm8623);
+}
+
+static void do_work(struct work_struct *work)
+{
+	struct acm8623_priv *acm8623 =
+	       container_of(work, struct acm8623_priv, work);
+	struct acm8623_group *group = acm8623->group;
+	struct regmap *rm = acm8623->regmap;
+	ktime_t start = ktime_get();
+	bool uploaded, sent, counted, synced;
+	int ret = 0;
+
+	dev_dbg(&acm8623->i2c->dev, "DSP startup\n");
+
+	/* We mustn't issue any I2C transactions until the I2S
+	 * clock is stable. Furthermore, we must allow a 5ms
+	 * delay after the first set of register writes to
+	 * allow the DSP to boot before configuring it.
+	 */
+	usleep_range(5000, 10000);
+
+	if (group)
+		mutex_lock(&group->lock);
+	mutex_lock(&acm8623->lock);
+	/* Only a blob written in this pass can be checked against. A
+	 * config that was already in place has the volume on top.
+	 */
+	uploaded = !acm8623->cfg_valid;
+	sent = acm8623_group_send_cfg(acm8623);
+
+	/* Once counted as active, no broadcast can reboot it, so its
+	 * own upload runs without the group lock
+	 */
+	counted = group && !acm8623->is_powered;
+	if (counted)
+		group->active++;
+	if (group)
+		mutex_unlock(&group->lock);
+
+	if (!sent) {
+		ret = acm8623_upload(acm8623, rm);
+		acm8623->cfg_valid = !ret;
+		uploaded = true;
+	}
+	if (!ret && verify && uploaded)
+		ret = acm8623_verify_cfg(acm8623);
+	if (!ret)
+		ret = acm8623_apply_fmt(acm8623);
+
+	/* A half-configured DSP must not be started. It stays off until
+	 * the next stream start tries again.
+	 */
+	if (ret) {
+		acm8623_set_failed(acm8623, ret);
+		mutex_unlock(&acm8623->lock);
+		if (counted) {
+			mutex_lock(&group->lock);
+			group->active--;
+			mutex_unlock(&group->lock);
+		}
+		return;
+	}
+
+	acm8623->is_powered = true;
+	if (acm8623->link) {
+		/* Everything but the final PLAY write, which is gated
+		 * on the other instances of the link.
+		 */
+		ret = acm8623_write_volume(acm8623, rm, ACM8623_CHANNELS);
+		acm8623->link_pending = !ret;
+		mutex_unlock(&acm8623->lock);
+		synced = acm8623_link_start(acm8623);
+		mutex_lock(&acm8623->lock);
+
+		/* A fault recovery that failed meanwhile switched it off */
+		if (!acm8623->is_powered) {
+			mutex_unlock(&acm8623->lock);
+			return;
+		}
+
+		if (!synced) {
+			acm8623->link_pending = false;
+			if (!ret)
+				ret = acm8623_write(acm8623, rm,
+						     ACM8623_IO_REFRESH,
+						     REG_DEVICE_STATE,
+						     acm8623_play_state(acm8623));
+			acm8623->play_time = ktime_get();
+		}
+	} else {
+		ret = acm8623_refresh(acm8623);
+		acm8623->play_time = ktime_get();
+	}
+
+	/* The DSP is configured; fault recovery keeps retrying the rest */
+	if (ret)
+		acm8623_set_failed(acm8623, ret);
+	else
+		acm8623->failed = false;
+
+	acm8623_hist_add(acm8623->stats.latency_hist,
+			  ktime_sub(acm8623->play_time, acm8623->trigger_time));
+	acm8623_hist_add(acm8623->stats.work_hist,
+			  ktime_sub(ktime_get(), start));
+
+	if (!acm8623->fault_irq) {
+		acm8623->fault_poll_ms = ACM8623_FAULT_POLL_MIN_MS;
+		queue_delayed_work(system_power_efficient_wq,
+				   &acm8623->fault_work,
+				   msecs_to_jiffies(acm8623->fault_poll_ms));
+	}
+	mutex_unlock(&acm8623->lock);
+}
+
+static int acm8623_dac_event(struct snd_soc_dapm_widget *w,
+			      struct snd_kcontrol *kcontrol, int event)
+{
+	struct snd_soc_component *component = snd_soc_dapm_to_component(w->dapm);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	struct acm8623_group *group = acm8623->group;
+	struct regmap *rm = acm8623->regmap;
+
+	if (event & SND_SOC_DAPM_PRE_PMD) {
+		u8 fault[ACM8623_FAULT_REGS] = { 0 };
 
 		dev_dbg(component->dev, "DSP shutdown\n");
 		cancel_work_sync(&acm8623->work);
+		cancel_delayed_work_sync(&acm8623->fault_work);
 
+		if (group)
+			mutex_lock(&group->lock);
 		mutex_lock(&acm8623->lock);
 		if (acm8623->is_powered) {
 			acm8623->is_powered = false;
+			acm8623->cfg_valid = false;
+			if (group)
+				group->active--;
+
+			acm8623_write(acm8623, rm, ACM8623_IO_CTRL,
+				       REG_PAGE, 0x00);
+
+			acm8623_read_faults(acm8623, fault);
+
+			dev_dbg(component->dev, "fault regs: CHANNEL=%02x, "
+				"GLOBAL1=%02x, GLOBAL2=%02x, GLOBAL3=%02x\n",
+				fault[0], fault[1], fault[2], fault[3]);
+
+			acm8623_write(acm8623, rm, ACM8623_IO_CTRL,
+				       REG_DEVICE_STATE, DEVICE_STATE_HIZ);
+		}
+		mutex_unlock(&acm8623->lock);
+		if (group)
+			mutex_unlock(&group->lock);
+	}
+
+	return 0;
+}
+
+static const struct snd_soc_dapm_route acm8623_audio_map[] = {
+	{ "DAC", NULL, "DAC IN" },
+	{ "OUT", NULL, "DAC" },
+};
+
+static const struct snd_soc_dapm_widget acm8623_dapm_widgets[] = {
+	SND_SOC_DAPM_AIF_IN("DAC IN", "Playback", 0, SND_SOC_NOPM, 0, 0),
+	SND_SOC_DAPM_DAC_E("DAC", NULL, SND_SOC_NOPM, 0, 0,
+		acm8623_dac_event, SND_SOC_DAPM_PRE_PMD),
+	SND_SOC_DAPM_OUTPUT("OUT")
+};
+
+#ifdef CONFIG_DEBUG_FS
+static const char * const acm8623_io_phase_names[] = {
+	[ACM8623_IO_CFG]		= "cfg",
+	[ACM8623_IO_REFRESH]	= "refresh",
+	[ACM8623_IO_CTRL]		= "ctrl",
+	[ACM8623_IO_DEBUG]		= "debug",
+};
+
+static void acm8623_show_hist(struct seq_file *m, const char *name,
+			       const u32 *hist)
+{
+	int i;
+
+	seq_printf(m, "%s:\n", name);
+	for (i = 0; i < ACM8623_HIST_BUCKETS; i++) {
+		if (!i)
+			seq_printf(m, "  %9s ms: %u\n", "<1", hist[i]);
+		else if (i == ACM8623_HIST_BUCKETS - 1)
+			seq_printf(m, "  >=%7u ms: %u\n", 1 << (i - 1), hist[i]);
+		else
+			seq_printf(m, "  %4u-%-4u ms: %u\n",
+				   1 << (i - 1), 1 << i, hist[i]);
+	}
+}
+
+static int acm8623_stats_show(struct seq_file *m, void *v)
+{
+	struct acm8623_priv *acm8623 = m->private;
+	struct acm8623_stats stats;
+	int fail_reg;
+	bool failed;
+	s64 skew;
+	int i;
+
+	mutex_lock(&acm8623->lock);
+	stats = acm8623->stats;
+	skew = acm8623->link_skew_ns;
+	failed = acm8623->failed;
+	fail_reg = acm8623->cfg_fail_reg;
+	mutex_unlock(&acm8623->lock);
+
+	seq_printf(m, "%-8s %10s %12s %12s\n", "phase", "xfers", "bytes",
+		   "bus_us");
+	for (i = 0; i < ACM8623_IO_PHASES; i++)
+		seq_printf(m, "%-8s %10llu %12llu %12llu\n",
+			   acm8623_io_phase_names[i], stats.io[i].xfers,
+			   stats.io[i].bytes,
+			   div_u64(stats.io[i].bus_ns, NSEC_PER_USEC));
+
+	seq_printf(m, "page_switches: %llu\n", stats.page_switches);
+	seq_printf(m, "reads: %llu\n", stats.reads);
+	seq_printf(m, "errors: %llu\n", stats.errors);
+	seq_printf(m, "faults: %llu\n", stats.faults);
+	seq_printf(m, "recoveries: %llu\n", stats.recoveries);
+	seq_printf(m, "reconfigs: %llu\n", stats.reconfigs);
+	seq_printf(m, "retries: %llu\n", stats.retries);
+	seq_printf(m, "segment_retries: %llu\n", stats.segment_retries);
+	seq_printf(m, "failures: %llu\n", stats.failures);
+	seq_printf(m, "verified_pages: %llu\n", stats.verified_pages);
+	seq_printf(m, "verify_mismatches: %llu\n", stats.verify_mismatches);
+	seq_printf(m, "verify_failures: %llu\n", stats.verify_failures);
+	seq_printf(m, "delta_updates: %llu\n", stats.delta_updates);
+	seq_printf(m, "delta_regs: %llu\n", stats.delta_regs);
+	seq_printf(m, "delta_skipped: %llu\n", stats.delta_skipped);
+	seq_printf(m, "failed: %d\n", failed);
+	if (failed && fail_reg >= 0)
+		seq_printf(m, "failed_at: page %02x reg %02x\n",
+			   fail_reg >> 8, fail_reg & 0xff);
+	seq_printf(m, "link_skew_ns: %lld\n", skew);
+
+	acm8623_show_hist(m, "do_work duration", stats.work_hist);
+	acm8623_show_hist(m, "trigger to PLAY latency", stats.latency_hist);
+
+	return 0;
+}
+
+static int acm8623_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, acm8623_stats_show, inode->i_private);
+}
+
+/* Any write resets the counters */
+static ssize_t acm8623_stats_write(struct file *file,
+				    const char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct acm8623_priv *acm8623 = m->private;
+
+	mutex_lock(&acm8623->lock);
+	memset(&acm8623->stats, 0, sizeof(acm8623->stats));
+	mutex_unlock(&acm8623->lock);
+
+	return count;
+}
+
+static const struct file_operations acm8623_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= acm8623_stats_open,
+	.read		= seq_read,
+	.write		= acm8623_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* Pages shown in debugfs: the ones the driver and the tuning
+ * blobs write to.
+ */
+static const u8 acm8623_dump_pages[] = { 0x00, 0x01, 0x04, 0x05, 0x06, 0x0b };
+
+struct acm8623_page_dump {
+	struct acm8623_priv	*priv;
+	int						index;	/* -1 for all pages */
+};
+
+/* Each page is fetched with a single bulk read. The group lock keeps
+ * broadcasts from switching our page underneath us.
+ */
+static int acm8623_read_pages(struct acm8623_priv *acm8623,
+			       const u8 *pages, int n, u8 *buf)
+{
+	struct acm8623_group *group = acm8623->group;
+	struct regmap *rm = acm8623->regmap;
+	int i, ret = 0;
+
+	if (group)
+		mutex_lock(&group->lock);
+	mutex_lock(&acm8623->lock);
+	for (i = 0; i < n && !ret; i++) {
+		ret = acm8623_write(acm8623, rm, ACM8623_IO_DEBUG,
+				     REG_PAGE, pages[i]);
+		if (!ret)
+			ret = acm8623_bulk_read(acm8623, ACM8623_IO_DEBUG, 0,
+						 buf + i * ACM8623_PAGE_SIZE,
+						 ACM8623_PAGE_SIZE);
+	}
+	acm8623_write(acm8623, rm, ACM8623_IO_DEBUG, REG_PAGE, 0x00);
+	mutex_unlock(&acm8623->lock);
+	if (group)
+		mutex_unlock(&group->lock);
+
+	return ret;
+}
+
+static int acm8623_regs_show(struct seq_file *m, void *v)
+{
+	struct acm8623_page_dump *dump = m->private;
+	const u8 *pages = acm8623_dump_pages;
+	int n = ARRAY_SIZE(acm8623_dump_pages);
+	int i, j, ret;
+	u8 *buf;
+
+	if (dump->index >= 0) {
+		pages += dump->index;
+		n = 1;
+	}
+
+	buf = kmalloc_array(n, ACM8623_PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = acm8623_read_pages(dump->priv, pages, n, buf);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		if (n > 1)
+			seq_printf(m, "page %02x:\n", pages[i]);
+		for (j = 0; j < ACM8623_PAGE_SIZE; j += 16)
+			seq_printf(m, "%02x: %*ph\n", j, 16,
+				   buf + i * ACM8623_PAGE_SIZE + j);
+	}
+out:
+	kfree(buf);
+	return ret;
+}
+
+static int acm8623_regs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, acm8623_regs_show, inode->i_private);
+}
+
+static const struct file_operations acm8623_regs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= acm8623_regs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void acm8623_debugfs_init(struct snd_soc_component *component,
+				  struct dentry *root)
+{
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	struct acm8623_page_dump *dumps;
+	struct dentry *dir;
+	char name[8];
+	int i, n = ARRAY_SIZE(acm8623_dump_pages);
+
+	debugfs_create_file("stats", 0644, root, acm8623,
+			    &acm8623_stats_fops);
+
+	/* One entry per page plus one for a snapshot of all of them */
+	dumps = devm_kcalloc(component->dev, n + 1, sizeof(*dumps),
+			     GFP_KERNEL);
+	if (!dumps)
+		return;
+
+	dir = debugfs_create_dir("regs", root);
+	for (i = 0; i <= n; i++) {
+		dumps[i].priv = acm8623;
+		dumps[i].index = i < n ? i : -1;
+		if (i < n)
+			snprintf(name, sizeof(name), "page%02x",
+				 acm8623_dump_pages[i]);
+		else
+			strscpy(name, "all", sizeof(name));
+		debugfs_create_file(name, 0444, dir, &dumps[i],
+				    &acm8623_regs_fops);
+	}
+}
+#endif
+
+static int acm8623_profile_info(struct snd_kcontrol *kcontrol,
+				 struct snd_ctl_elem_info *uinfo)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+
+	return snd_ctl_enum_info(uinfo, 1, acm8623->num_profiles,
+				 acm8623->profile_names);
+}
+
+static int acm8623_profile_get(struct snd_kcontrol *kcontrol,
+				struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+
+	mutex_lock(&acm8623->lock);
+	ucontrol->value.enumerated.item[0] = acm8623->profile;
+	mutex_unlock(&acm8623->lock);
 
-			regmap_write(rm, REG_PAGE, 0x00);
+	return 0;
+}
 
-			regmap_read(rm, REG_STATE_REPORT, &channel_state);
-			regmap_read(rm, REG_GLOBAL_FAULT1, &global1);
-			regmap_read(rm, REG_GLOBAL_FAULT2, &global2);
-			regmap_read(rm, REG_GLOBAL_FAULT3, &global3);
+static int acm8623_profile_put(struct snd_kcontrol *kcontrol,
+				struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	struct acm8623_group *group = acm8623->group;
+	unsigned int profile = ucontrol->value.enumerated.item[0];
+	int ret = 0;
 
-			dev_dbg(component->dev, "fault regs: CHANNEL=%02x, "
-				"GLOBAL1=%02x, GLOBAL2=%02x, GLOBAL3=%02x\n",
-				channel_state, global1, global2, global3);
+	if (profile >= acm8623->num_profiles)
+		return -EINVAL;
 
-			regmap_write(rm, REG_DEVICE_STATE, DEVICE_STATE_HIZ);
-		}
-		mutex_unlock(&acm8623->lock);
+	/* The group lock keeps a broadcast from racing the switch */
+	if (group)
+		mutex_lock(&group->lock);
+	mutex_lock(&acm8623->lock);
+	if (acm8623->profile != profile) {
+		ret = acm8623_set_profile(acm8623, profile);
+		if (!ret)
+			ret = 1;
 	}
+	mutex_unlock(&acm8623->lock);
+	if (group)
+		mutex_unlock(&group->lock);
 
-	return 0;
+	return ret;
 }
 
-static const struct snd_soc_dapm_route acm8623_audio_map[] = {
-	{ "DAC", NULL, "DAC IN" },
-	{ "OUT", NULL, "DAC" },
+static const struct snd_kcontrol_new acm8623_profile_controls[] = {
+	{
+		.iface	= SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name	= "DSP Profile",
+		.access	= SNDRV_CTL_ELEM_ACCESS_READWRITE,
+		.info	= acm8623_profile_info,
+		.get	= acm8623_profile_get,
+		.put	= acm8623_profile_put,
+	},
 };
 
-static const struct snd_soc_dapm_widget acm8623_dapm_widgets[] = {
-	SND_SOC_DAPM_AIF_IN("DAC IN", "Playback", 0, SND_SOC_NOPM, 0, 0),
-	SND_SOC_DAPM_DAC_E("DAC", NULL, SND_SOC_NOPM, 0, 0,
-		acm8623_dac_event, SND_SOC_DAPM_PRE_PMD),
-	SND_SOC_DAPM_OUTPUT("OUT")
-};
+/* The DSP profile control is only there if there is a choice. The group
+ * volume control is exposed once per group, by its first member.
+ */
+static int acm8623_component_probe(struct snd_soc_component *component)
+{
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(component);
+	struct acm8623_group *group = acm8623->group;
+	bool owner;
+	int ret;
+
+	acm8623->component = component;
+
+	if (acm8623->num_profiles > 1) {
+		ret = snd_soc_add_component_controls(component,
+				acm8623_profile_controls,
+				ARRAY_SIZE(acm8623_profile_controls));
+		if (ret)
+			return ret;
+	}
+
+	if (!group)
+		return 0;
+
+	mutex_lock(&group->lock);
+	owner = list_first_entry(&group->members, struct acm8623_priv,
+				 group_node) == acm8623;
+	mutex_unlock(&group->lock);
+
+	if (!owner)
+		return 0;
+
+	return snd_soc_add_component_controls(component,
+			acm8623_group_controls,
+			ARRAY_SIZE(acm8623_group_controls));
+}
 
 static const struct snd_soc_component_driver soc_codec_dev_acm8623 = {
+	.probe				= acm8623_component_probe,
+#ifdef CONFIG_DEBUG_FS
+	.debugfs_init		= acm8623_debugfs_init,
+#endif
 	.controls			= acm8623_snd_controls,
 	.num_controls		= ARRAY_SIZE(acm8623_snd_controls),
 	.dapm_widgets		= acm8623_dapm_widgets,
@@ -467,6 +2733,7 @@ static int acm8623_mute(struct snd_soc_dai *dai, int mute, int direction)
 	struct snd_soc_component *component = dai->component;
 	struct acm8623_priv *acm8623 =
 		snd_soc_component_get_drvdata(component);
+	int ret = 0;
 
 	mutex_lock(&acm8623->lock);
 	dev_dbg(component->dev, "set mute=%d (is_powered=%d)\n",
@@ -474,13 +2741,83 @@ static int acm8623_mute(struct snd_soc_dai *dai, int mute, int direction)
 
 	acm8623->is_muted = mute;
 	if (acm8623->is_powered)
-		acm8623_refresh(acm8623);
+		ret = acm8623_refresh(acm8623);
 	mutex_unlock(&acm8623->lock);
 
+	return ret;
+}
+
+static int acm8623_startup(struct snd_pcm_substream *substream,
+			    struct snd_soc_dai *dai)
+{
+	struct snd_soc_pcm_runtime *rtd = asoc_substream_to_rtd(substream);
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(dai->component);
+	struct acm8623_link *link;
+	struct snd_soc_dai *codec_dai;
+	int members = 0;
+	int i;
+
+	for_each_rtd_codec_dais(rtd, i, codec_dai)
+		if (codec_dai->component->driver == &soc_codec_dev_acm8623)
+			members++;
+
+	if (members < 2)
+		return 0;
+
+	mutex_lock(&acm8623_links_lock);
+	list_for_each_entry(link, &acm8623_links, node) {
+		if (link->rtd == rtd)
+			goto found;
+	}
+
+	link = kzalloc(sizeof(*link), GFP_KERNEL);
+	if (!link) {
+		mutex_unlock(&acm8623_links_lock);
+		return -ENOMEM;
+	}
+
+	link->rtd = rtd;
+	link->members = members;
+	INIT_LIST_HEAD(&link->arrived);
+	init_waitqueue_head(&link->wq);
+	mutex_init(&link->lock);
+	list_add_tail(&link->node, &acm8623_links);
+
+found:
+	link->refs++;
+	acm8623->link = link;
+	mutex_unlock(&acm8623_links_lock);
+
 	return 0;
 }
 
+static void acm8623_shutdown(struct snd_pcm_substream *substream,
+			      struct snd_soc_dai *dai)
+{
+	struct acm8623_priv *acm8623 =
+		snd_soc_component_get_drvdata(dai->component);
+	struct acm8623_link *link = acm8623->link;
+
+	if (!link)
+		return;
+
+	/* The boot work may still be parked on the link barrier */
+	cancel_work_sync(&acm8623->work);
+
+	mutex_lock(&acm8623_links_lock);
+	acm8623->link = NULL;
+	if (!--link->refs) {
+		list_del(&link->node);
+		kfree(link);
+	}
+	mutex_unlock(&acm8623_links_lock);
+}
+
 static const struct snd_soc_dai_ops acm8623_dai_ops = {
+	.startup			= acm8623_startup,
+	.shutdown			= acm8623_shutdown,
+	.set_fmt			= acm8623_set_fmt,
 	.trigger			= acm8623_trigger,
 	.mute_stream		= acm8623_mute,
 	.no_capture_mute	= 1,
@@ -509,16 +2846,522 @@ static const struct regmap_config acm8623_regmap = {
 	.cache_type	= REGCACHE_NONE,
 };
 
+static int acm8623_group_join(struct acm8623_priv *acm8623, u32 addr)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	struct i2c_adapter *adapter = acm8623->i2c->adapter;
+	struct acm8623_group *group;
+	struct acm8623_priv *peer;
+	int ret = 0;
+
+	if (addr > 0x7f || addr == acm8623->i2c->addr) {
+		dev_err(dev, "invalid group address 0x%02x\n", addr);
+		return -EINVAL;
+	}
+
+	mutex_lock(&acm8623_groups_lock);
+	list_for_each_entry(group, &acm8623_groups, node) {
+		if (group->adapter == adapter && group->client->addr == addr)
+			goto found;
+	}
+
+	group = kzalloc(sizeof(*group), GFP_KERNEL);
+	if (!group) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	group->client = i2c_new_dummy_device(adapter, addr);
+	if (IS_ERR(group->client)) {
+		ret = PTR_ERR(group->client);
+		dev_err(dev, "unable to claim group address 0x%02x: %d\n",
+			addr, ret);
+		kfree(group);
+		goto out;
+	}
+
+	group->regmap = regmap_init_i2c(group->client, &acm8623_regmap);
+	if (IS_ERR(group->regmap)) {
+		ret = PTR_ERR(group->regmap);
+		i2c_unregister_device(group->client);
+		kfree(group);
+		goto out;
+	}
+
+	group->adapter = adapter;
+	INIT_LIST_HEAD(&group->members);
+	group->vol = acm8623_vol_0db(acm8623);
+	mutex_init(&group->lock);
+	list_add_tail(&group->node, &acm8623_groups);
+
+found:
+	/* Broadcasting only makes sense if everyone runs the same tuning */
+	mutex_lock(&group->lock);
+	if (!list_empty(&group->members)) {
+		peer = list_first_entry(&group->members,
+					struct acm8623_priv, group_node);
+		if (!acm8623_profiles_equal(acm8623, peer)) {
+			dev_warn(dev, "config differs from group 0x%02x, "
+				 "not joining\n", addr);
+			mutex_unlock(&group->lock);
+			goto out;
+		}
+	}
+	acm8623->group = group;
+	list_add_tail(&acm8623->group_node, &group->members);
+	group->size++;
+	mutex_unlock(&group->lock);
+
+	dev_info(dev, "joined broadcast group 0x%02x\n", addr);
+out:
+	mutex_unlock(&acm8623_groups_lock);
+	return ret;
+}
+
+static void acm8623_group_leave(struct acm8623_priv *acm8623)
+{
+	struct acm8623_group *group = acm8623->group;
+
+	if (!group)
+		return;
+
+	mutex_lock(&acm8623_groups_lock);
+	mutex_lock(&group->lock);
+	list_del(&acm8623->group_node);
+	group->size--;
+	acm8623->group = NULL;
+	mutex_unlock(&group->lock);
+
+	if (list_empty(&group->members)) {
+		list_del(&group->node);
+		regmap_exit(group->regmap);
+		i2c_unregister_device(group->client);
+		kfree(group);
+	}
+	mutex_unlock(&acm8623_groups_lock);
+}
+
+/* Set up a shadow for every DSP page one of the profiles writes,
+ * keeping what is known about pages that were tracked before
+ */
+static int acm8623_shadow_init(struct acm8623_priv *acm8623,
+				const struct acm8623_cfg *profiles)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	DECLARE_BITMAP(pages, ACM8623_PAGES);
+	DECLARE_BITMAP(used, ACM8623_PAGES);
+	struct acm8623_shadow *shadow, *sh;
+	unsigned int i, page, n;
+
+	bitmap_zero(used, ACM8623_PAGES);
+	for (i = 0; i < acm8623->num_profiles; i++) {
+		acm8623_cfg_pages(&profiles[i], pages);
+		bitmap_or(used, used, pages, ACM8623_PAGES);
+	}
+
+	n = bitmap_weight(used, ACM8623_PAGES);
+	shadow = devm_kcalloc(dev, n ?: 1, sizeof(*shadow), GFP_KERNEL);
+	if (!shadow)
+		return -ENOMEM;
+
+	i = 0;
+	for_each_set_bit(page, used, ACM8623_PAGES) {
+		sh = acm8623_shadow_page(acm8623, page);
+		if (sh)
+			shadow[i] = *sh;
+		else
+			shadow[i].page = page;
+		i++;
+	}
+
+	if (acm8623->shadow)
+		devm_kfree(dev, acm8623->shadow);
+	acm8623->shadow = shadow;
+	acm8623->num_shadow = n;
+
+	return 0;
+}
+
+/* An LZ4 frame as written by the lz4 tool: a header, blocks that are
+ * compressed or stored, an end mark and optionally a checksum of the
+ * content. Blocks may refer back to earlier ones.
+ */
+static int acm8623_unpack_lz4(const u8 *src, size_t len, u8 **buf,
+			       size_t *size)
+{
+	const u8 *end = src + len, *p = src + 4;
+	size_t cap = ACM8623_FW_MAX_SIZE, out = 0, hdr;
+	u8 flg, bd;
+	u32 blk;
+	u8 *dst;
+	int n;
+
+	if (len < 7)
+		return -EINVAL;
+
+	flg = p[0];
+	bd = p[1];
+	hdr = 2 + (flg & BIT(3) ? 8 : 0);
+
+	/* Version 01, no dictionary, block size 64K..4M */
+	if ((flg & 0xc3) != 0x40 || (bd & 0x8f) || ((bd >> 4) & 7) < 4 ||
+	    len < 4 + hdr + 1)
+		return -EINVAL;
+	if (((xxh32(p, hdr, 0) >> 8) & 0xff) != p[hdr])
+		return -EBADMSG;
+
+	if (flg & BIT(3)) {
+		if (get_unaligned_le64(p + 2) > ACM8623_FW_MAX_SIZE)
+			return -EFBIG;
+		cap = get_unaligned_le64(p + 2);
+	}
+	p += hdr + 1;
+
+	dst = kvmalloc(cap ?: 1, GFP_KERNEL);
+	if (!dst)
+		return -ENOMEM;
+
+	for (;;) {
+		if (end - p < 4)
+			goto bad;
+		blk = get_unaligned_le32(p);
+		p += 4;
+		if (!blk)
+			break;
+
+		if ((blk & 0x7fffffff) + (flg & BIT(4) ? 4 : 0) > end - p)
+			goto bad;
+
+		if (blk & BIT(31)) {
+			blk &= 0x7fffffff;
+			if (blk > cap - out)
+				goto bad;
+			memcpy(dst + out, p, blk);
+			n = blk;
+		} else if (flg & BIT(5)) {
+			n = LZ4_decompress_safe((const char *)p,
+						(char *)dst + out, blk,
+						cap - out);
+		} else {
+			n = LZ4_decompress_safe_usingDict((const char *)p,
+							  (char *)dst + out,
+							  blk, cap - out,
+							  (char *)dst, out);
+		}
+		if (n < 0)
+			goto bad;
+
+		out += n;
+		p += blk + (flg & BIT(4) ? 4 : 0);
+	}
+
+	if ((flg & BIT(3)) && out != cap)
+		goto bad;
+	if ((flg & BIT(2)) &&
+	    (end - p < 4 || xxh32(dst, out, 0) != get_unaligned_le32(p)))
+		goto bad;
+
+	*buf = dst;
+	*size = out;
+	return 0;
+
+bad:
+	kvfree(dst);
+	return -EBADMSG;
+}
+
+static int acm8623_unpack_zstd(const u8 *src, size_t len, u8 **buf,
+				size_t *size)
+{
+	zstd_frame_header hdr;
+	size_t cap = ACM8623_FW_MAX_SIZE, ws_size, n;
+	zstd_dctx *dctx;
+	void *ws;
+	u8 *dst;
+	int ret = 0;
+
+	if (zstd_get_frame_header(&hdr, src, len))
+		return -EINVAL;
+
+	if (hdr.frameContentSize != ZSTD_CONTENTSIZE_UNKNOWN) {
+		if (hdr.frameContentSize > ACM8623_FW_MAX_SIZE)
+			return -EFBIG;
+		cap = hdr.frameContentSize;
+	}
+
+	ws_size = zstd_dctx_workspace_bound();
+	ws = kvmalloc(ws_size, GFP_KERNEL);
+	dst = kvmalloc(cap ?: 1, GFP_KERNEL);
+	if (!ws || !dst) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	dctx = zstd_init_dctx(ws, ws_size);
+	n = dctx ? zstd_decompress_dctx(dctx, dst, cap, src, len) : 0;
+	if (!dctx || zstd_is_error(n)) {
+		ret = -EBADMSG;
+		goto out;
+	}
+
+	*buf = dst;
+	*size = n;
+	dst = NULL;
+out:
+	kvfree(dst);
+	kvfree(ws);
+	return ret;
+}
+
+/* Tuning blobs may be compressed with lz4 or zstd to save space. They
+ * are unpacked into a buffer the caller frees with kvfree(); *buf is
+ * left alone if the blob is not compressed.
+ */
+static int acm8623_unpack(struct device *dev, const u8 *data, size_t size,
+			   u8 **buf, size_t *len)
+{
+	u32 magic;
+
+	if (size < 4)
+		return 0;
+
+	magic = get_unaligned_le32(data);
+	if (magic == ACM8623_LZ4_MAGIC) {
+		if (!IS_ENABLED(CONFIG_LZ4_DECOMPRESS)) {
+			dev_err(dev, "LZ4 support is not built in\n");
+			return -EOPNOTSUPP;
+		}
+		return acm8623_unpack_lz4(data, size, buf, len);
+	}
+
+	if (magic == ACM8623_ZSTD_MAGIC) {
+		if (!IS_ENABLED(CONFIG_ZSTD_DECOMPRESS)) {
+			dev_err(dev, "zstd support is not built in\n");
+			return -EOPNOTSUPP;
+		}
+		return acm8623_unpack_zstd(data, size, buf, len);
+	}
+
+	return 0;
+}
+
+/* Take the volume curve off the front of a blob, or use the built-in
+ * one if it has none
+ */
+static int acm8623_load_curve(const u8 **data, size_t *size,
+			       struct acm8623_curve *vol)
+{
+	const u8 *p = *data;
+	unsigned int i, n, len;
+	u32 *coef;
+
+	*vol = acm8623_curve_default;
+	if (*size < ACM8623_VOL_HDR_SIZE ||
+	    get_unaligned_le32(p) != ACM8623_VOL_MAGIC)
+		return 0;
+
+	n = get_unaligned_le16(p + 4);
+	len = ACM8623_VOL_HDR_SIZE + n * 4;
+	if (n < 2 || n > ACM8623_VOL_MAX_STEPS || !get_unaligned_le16(p + 6) ||
+	    *size < len)
+		return -EINVAL;
+
+	coef = kcalloc(n, sizeof(*coef), GFP_KERNEL);
+	if (!coef)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++)
+		coef[i] = get_unaligned_le32(p + ACM8623_VOL_HDR_SIZE + i * 4);
+
+	vol->min = (s32)get_unaligned_le32(p + 8);
+	vol->step = get_unaligned_le16(p + 6);
+	vol->count = n;
+	vol->coef = coef;
+
+	*data += len;
+	*size -= len;
+	return 0;
+}
+
+/* The volume controls keep their steps for the life of the device, so
+ * every profile has to come with the same
+ */
+static int acm8623_check_curves(struct acm8623_priv *acm8623,
+				 const struct acm8623_cfg *profiles)
+{
+	const struct acm8623_curve *vol;
+	unsigned int i;
+
+	for (i = 0; i < acm8623->num_profiles; i++) {
+		vol = &profiles[i].vol;
+		if (vol->min != acm8623->vol_min ||
+		    vol->step != acm8623->vol_step ||
+		    vol->count != acm8623->vol_count) {
+			dev_err(&acm8623->i2c->dev,
+				"volume steps of DSP profile %s differ\n",
+				acm8623->profile_names[i]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* Load the tuning blob of a DSP profile, or the built-in one if there
+ * is no firmware file for it
+ */
+static int acm8623_load_profile(struct acm8623_priv *acm8623,
+				 const char *name, struct acm8623_cfg *cfg)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	const struct firmware *fw;
+	char filename[128];
+	const u8 *data;
+	u8 *buf = NULL;
+	size_t size;
+	int ret;
+
+	snprintf(filename, sizeof(filename), "acm8623_dsp_%s.bin", name);
+	ret = request_firmware(&fw, filename, dev);
+	if (ret) {
+		cfg->vol = acm8623_curve_default;
+		return acm8623_compile(dsp_cfg_default,
+					ARRAY_SIZE(dsp_cfg_default), cfg);
+	}
+
+	data = fw->data;
+	size = fw->size;
+	ret = acm8623_unpack(dev, data, size, &buf, &size);
+	if (buf)
+		data = buf;
+
+	if (!ret)
+		ret = acm8623_load_curve(&data, &size, &cfg->vol);
+	if (!ret && ((size < 2) || (size & 1)))
+		ret = -EINVAL;
+	if (ret) {
+		dev_err(dev, "firmware %s is invalid: %d\n", filename, ret);
+		goto out;
+	}
+
+	if (buf)
+		dev_dbg(dev, "%s: %zu bytes unpacked from %zu\n", filename,
+			size, fw->size);
+	if (cfg->vol.coef)
+		dev_dbg(dev, "%s: %u volume steps of %u from %d\n", filename,
+			cfg->vol.count, cfg->vol.step, cfg->vol.min);
+
+	ret = acm8623_compile(data, size, cfg);
+out:
+	kvfree(buf);
+	release_firmware(fw);
+
+	return ret;
+}
+
+/* Blobs are swapped at runtime, so they are not devm allocations */
+static void acm8623_cfg_free(struct acm8623_cfg *cfg)
+{
+	kfree(cfg->segs);
+	kfree(cfg->data);
+	kfree(cfg->vol.coef);
+}
+
+static void acm8623_profiles_free(struct acm8623_cfg *profiles,
+				   unsigned int n)
+{
+	unsigned int i;
+
+	if (!profiles)
+		return;
+
+	for (i = 0; i < n; i++)
+		acm8623_cfg_free(&profiles[i]);
+	kfree(profiles);
+}
+
+/* Request the tuning blobs of all profiles again and swap them in. If
+ * the active one changed while playing, only the registers that differ
+ * are written and the stream goes on.
+ */
+static int acm8623_reload(struct acm8623_priv *acm8623)
+{
+	struct device *dev = &acm8623->i2c->dev;
+	struct acm8623_group *group = acm8623->group;
+	struct acm8623_cfg *profiles, *old;
+	const struct acm8623_cfg *from;
+	unsigned int i, n = acm8623->num_profiles;
+	int ret = 0;
+
+	profiles = kcalloc(n, sizeof(*profiles), GFP_KERNEL);
+	if (!profiles)
+		return -ENOMEM;
+
+	for (i = 0; i < n && !ret; i++)
+		ret = acm8623_load_profile(acm8623, acm8623->profile_names[i],
+					    &profiles[i]);
+	if (!ret)
+		ret = acm8623_check_curves(acm8623, profiles);
+	if (ret)
+		goto out;
+
+	if (group)
+		mutex_lock(&group->lock);
+	mutex_lock(&acm8623->lock);
+	ret = acm8623_shadow_init(acm8623, profiles);
+	if (!ret) {
+		old = acm8623->profiles;
+		from = acm8623_cfg(acm8623);
+		acm8623->profiles = profiles;
+		profiles = old;
+
+		if (acm8623_cfg_equal(from, acm8623_cfg(acm8623)))
+			dev_dbg(dev, "active DSP profile unchanged\n");
+		else
+			ret = acm8623_apply_profile(acm8623, from);
+	}
+	mutex_unlock(&acm8623->lock);
+	if (group)
+		mutex_unlock(&group->lock);
+
+	dev_info(dev, "reloaded DSP profiles: %d\n", ret);
+out:
+	/* Whichever set of blobs is not in use */
+	acm8623_profiles_free(profiles, n);
+
+	return ret;
+}
+
+static ssize_t dsp_reload_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct acm8623_priv *acm8623 = dev_get_drvdata(dev);
+	int ret;
+
+	ret = acm8623_reload(acm8623);
+
+	return ret ?: count;
+}
+static DEVICE_ATTR_WO(dsp_reload);
+
+static struct attribute *acm8623_dev_attrs[] = {
+	&dev_attr_dsp_reload.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(acm8623_dev);
+
 static int acm8623_i2c_probe(struct i2c_client *i2c)
 {
 	struct device *dev = &i2c->dev;
 	struct regmap *regmap;
 	struct acm8623_priv *acm8623;
 
-	char filename[128];
-	const char *config_name;
-	const struct firmware *fw;
-	int ret;
+	const char *names[ACM8623_MAX_PROFILES];
+	struct gpio_desc *fault_gpio;
+	unsigned int i;
+	u32 group_addr;
+	int ret, n;
 
 	dev_info(dev, "acm8623_i2c_probe(): Start I2C Probe\n");
 
@@ -538,42 +3381,105 @@ static int acm8623_i2c_probe(struct i2c_client *i2c)
 	dev_set_drvdata(dev, acm8623);
 	acm8623->regmap = regmap;
 	
-	if (device_property_read_string(dev, "acme,dsp-config-name",
-					&config_name))
-		config_name = "default";
+	/* Either a list of DSP profiles, the first one used at start, or
+	 * a single tuning blob
+	 */
+	n = device_property_read_string_array(dev, "acme,dsp-profiles",
+					      names, ARRAY_SIZE(names));
+	if (n <= 0) {
+		if (device_property_read_string(dev, "acme,dsp-config-name",
+						&names[0]))
+			names[0] = "default";
+		n = 1;
+	}
 
-	snprintf(filename, sizeof(filename), "acm8623_dsp_%s.bin",
-		 config_name);
-	ret = request_firmware(&fw, filename, dev);
-	if (!ret) {
-		if ((fw->size < 2) || (fw->size & 1)) {
-			dev_err(dev, "firmware is invalid\n");
-			release_firmware(fw);
-			return -EINVAL;
-		}
+	/* The names point into the device tree, which outlives us */
+	acm8623->profiles = kcalloc(n, sizeof(*acm8623->profiles),
+				     GFP_KERNEL);
+	acm8623->profile_names = devm_kcalloc(dev, n,
+					       sizeof(*acm8623->profile_names),
+					       GFP_KERNEL);
+	if (!acm8623->profiles || !acm8623->profile_names) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
 
-		acm8623->dsp_cfg_len = fw->size;
-		acm8623->dsp_cfg_data = devm_kmalloc(dev, fw->size, GFP_KERNEL);
-		if (!acm8623->dsp_cfg_data) {
-			release_firmware(fw);
-			return -ENOMEM;
-		}
-		memcpy(acm8623->dsp_cfg_data, fw->data, fw->size);
+	for (i = 0; i < n; i++) {
+		acm8623->profile_names[i] = names[i];
+		ret = acm8623_load_profile(acm8623, names[i],
+					    &acm8623->profiles[i]);
+		if (ret)
+			goto err_free;
 
-		release_firmware(fw);
-	} else {
-		acm8623->dsp_cfg_len = 0;
-		acm8623->dsp_cfg_data = NULL;
+		dev_dbg(dev, "DSP profile %s: %u writes in %u segments\n",
+			names[i], acm8623->profiles[i].len,
+			acm8623->profiles[i].num_segs);
 	}
+	acm8623->num_profiles = n;
 
-	acm8623->vol[0] = ACM8623_VOLUME_0DB;
-	acm8623->vol[1] = ACM8623_VOLUME_0DB;
+	acm8623->vol_min = acm8623->profiles[0].vol.min;
+	acm8623->vol_step = acm8623->profiles[0].vol.step;
+	acm8623->vol_count = acm8623->profiles[0].vol.count;
+	ret = acm8623_check_curves(acm8623, acm8623->profiles);
+	if (ret)
+		goto err_free;
+
+	ret = acm8623_shadow_init(acm8623, acm8623->profiles);
+	if (ret)
+		goto err_free;
+
+	ret = acm8623_compile(dsp_cfg_preboot, ARRAY_SIZE(dsp_cfg_preboot),
+			       &acm8623->preboot);
+	if (ret)
+		goto err_free;
+
+	acm8623->vol[0] = acm8623_vol_0db(acm8623);
+	acm8623->vol[1] = acm8623_vol_0db(acm8623);
+	acm8623->cfg_fail_reg = -1;
 
 	usleep_range(100000, 150000);
 
 	INIT_WORK(&acm8623->work, do_work);
+	INIT_DELAYED_WORK(&acm8623->fault_work, acm8623_fault_poll);
 	mutex_init(&acm8623->lock);
 
+	/* Fault monitoring is interrupt driven if the FAULT pin is wired
+	 * up, and polled during playback otherwise.
+	 */
+	fault_gpio = devm_gpiod_get_optional(dev, "fault", GPIOD_IN);
+	if (IS_ERR(fault_gpio)) {
+		ret = PTR_ERR(fault_gpio);
+		dev_err(dev, "unable to get fault gpio: %d\n", ret);
+		goto err_free;
+	}
+
+	if (fault_gpio) {
+		ret = gpiod_to_irq(fault_gpio);
+		if (ret < 0) {
+			dev_err(dev, "fault gpio has no irq: %d\n", ret);
+			goto err_free;
+		}
+		acm8623->fault_irq = ret;
+
+		ret = devm_request_threaded_irq(dev, acm8623->fault_irq,
+						NULL, acm8623_fault_irq,
+						IRQF_ONESHOT |
+						(gpiod_is_active_low(fault_gpio) ?
+						 IRQF_TRIGGER_FALLING :
+						 IRQF_TRIGGER_RISING),
+						"acm8623-fault", acm8623);
+		if (ret) {
+			dev_err(dev, "unable to request fault irq: %d\n", ret);
+			goto err_free;
+		}
+	}
+
+	if (!device_property_read_u32(dev, "acme,group-address", &group_addr)) {
+		ret = acm8623_group_join(acm8623, group_addr);
+		if (ret)
+			goto err_free;
+	}
+
 	/* Don't register through devm. We need to be able to unregister
 	 * the component prior to deasserting PDN#
 	 */
@@ -581,10 +3487,17 @@ static int acm8623_i2c_probe(struct i2c_client *i2c)
 					 &acm8623_dai, 1);
 	if (ret < 0) {
 		dev_err(dev, "unable to register codec: %d\n", ret);
-		return ret;
+		acm8623_group_leave(acm8623);
+		goto err_free;
 	}
 
 	return 0;
+
+err_free:
+	acm8623_profiles_free(acm8623->profiles, n);
+	acm8623_cfg_free(&acm8623->preboot);
+
+	return ret;
 }
 
 static void acm8623_i2c_remove(struct i2c_client *i2c)
@@ -592,8 +3505,14 @@ static void acm8623_i2c_remove(struct i2c_client *i2c)
 	struct device *dev = &i2c->dev;
 	struct acm8623_priv *acm8623 = dev_get_drvdata(dev);
 
+	if (acm8623->fault_irq)
+		disable_irq(acm8623->fault_irq);
 	cancel_work_sync(&acm8623->work);
+	cancel_delayed_work_sync(&acm8623->fault_work);
 	snd_soc_unregister_component(dev);
+	acm8623_group_leave(acm8623);
+	acm8623_profiles_free(acm8623->profiles, acm8623->num_profiles);
+	acm8623_cfg_free(&acm8623->preboot);
 	usleep_range(10000, 15000);
 }
 
@@ -618,6 +3537,7 @@ static struct i2c_driver acm8623_i2c_driver = {
 	.driver		= {
 		.name		= "acm8623",
 		.of_match_table = of_match_ptr(acme8625s_of_match),
+		.dev_groups	= acm8623_dev_groups,
 	},
 };
 
@@ -0,0 +1,473 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// acmfw - optimize ACME Audio Tuning DSP configuration blobs
+//
+// A blob is a list of (register, value) byte pairs replayed one write
+// at a time, where register 0 selects the page. This tool resolves the
+// page of every write and rewrites the list so that it reaches the same
+// register state with fewer transactions:
+//
+//  - writes to a DSP page that a later write to the same register
+//    overrides are dropped,
+//  - the writes to each DSP page are gathered behind one page select
+//    and sorted by register, so they form contiguous runs,
+//  - redundant page selects are dropped.
+//
+// Page 0 holds control and status registers whose writes may have side
+// effects, so they are kept as they are and in order, and nothing is
+// moved across them. The remaining pages are assumed to be plain
+// coefficient memory. Each run of consecutive registers on one of them
+// is a burst segment that a single bus transaction can write. These are
+// the rules the drivers apply when they load a blob.
+//
+// A volume curve in front of the pairs is passed through unchanged once
+// it passes the checks of the drivers.
+//
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REG_PAGE	0x00
+
+/* "ACMV", steps (le16), step (le16), lowest level (le32), coefficients */
+#define VOL_MAGIC	0x564d4341
+#define VOL_HDR_SIZE	12
+#define VOL_MAX_STEPS	2048
+
+struct acmfw_write {
+	uint8_t		page;
+	uint8_t		reg;
+	uint8_t		val;
+	unsigned int	order;		/* first visit of the page */
+};
+
+struct acmfw_seg {
+	uint8_t		page;
+	uint8_t		reg;		/* REG_PAGE for a page select */
+	unsigned int	len;
+	const struct acmfw_write *w;
+};
+
+struct acmfw_cost {
+	unsigned long	xfers;
+	unsigned long	bytes;
+	unsigned long	bits;
+};
+
+static const unsigned int acmfw_freqs[] = { 100000, 400000, 1000000 };
+
+/* START, address, register, data..., STOP with ACKs, as a write of
+ * len data bytes goes out on the bus
+ */
+static void acmfw_account(struct acmfw_cost *cost, unsigned int len)
+{
+	cost->xfers++;
+	cost->bytes += 1 + len;
+	cost->bits += (2 + len) * 9 + 2;
+}
+
+static uint8_t *acmfw_read_file(const char *name, size_t *len)
+{
+	uint8_t *buf = NULL;
+	size_t size = 0, n;
+	FILE *f;
+
+	f = fopen(name, "rb");
+	if (!f)
+		return NULL;
+
+	do {
+		uint8_t *tmp = realloc(buf, size + 4096);
+
+		if (!tmp) {
+			free(buf);
+			fclose(f);
+			return NULL;
+		}
+		buf = tmp;
+		n = fread(buf + size, 1, 4096, f);
+		size += n;
+	} while (n == 4096);
+
+	if (ferror(f)) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+
+	*len = size;
+	return buf;
+}
+
+static uint32_t acmfw_le(const uint8_t *p, unsigned int n)
+{
+	uint32_t v = 0;
+
+	while (n--)
+		v = v << 8 | p[n];
+
+	return v;
+}
+
+/* Size of the volume curve a blob starts with, 0 if there is none or
+ * -1 if the driver would refuse it
+ */
+static long acmfw_curve_len(const uint8_t *blob, size_t len)
+{
+	size_t n;
+
+	if (len < VOL_HDR_SIZE || acmfw_le(blob, 4) != VOL_MAGIC)
+		return 0;
+
+	n = acmfw_le(blob + 4, 2);
+	if (n < 2 || n > VOL_MAX_STEPS || !acmfw_le(blob + 6, 2) ||
+	    len < VOL_HDR_SIZE + 4 * n)
+		return -1;
+
+	return VOL_HDR_SIZE + 4 * n;
+}
+
+/* Resolve the page of every register write. The driver starts each
+ * upload on page 0.
+ */
+static struct acmfw_write *acmfw_parse(const uint8_t *blob, size_t len,
+				       size_t *num, uint8_t *end_page)
+{
+	struct acmfw_write *w;
+	unsigned int order[256] = { 0 }, next = 1;
+	uint8_t page = 0;
+	size_t i, n = 0;
+
+	w = calloc(len / 2 ?: 1, sizeof(*w));
+	if (!w)
+		return NULL;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		if (blob[i] == REG_PAGE) {
+			page = blob[i + 1];
+			continue;
+		}
+
+		/* Pages are numbered by first visit since the last write
+		 * to page 0, which is where gathering starts over
+		 */
+		if (!page)
+			memset(order, 0, sizeof(order));
+		else if (!order[page])
+			order[page] = next++;
+
+		w[n].page = page;
+		w[n].reg = blob[i];
+		w[n].val = blob[i + 1];
+		w[n].order = order[page];
+		n++;
+	}
+
+	*num = n;
+	*end_page = page;
+	return w;
+}
+
+static int acmfw_cmp(const void *a, const void *b)
+{
+	const struct acmfw_write *x = a, *y = b;
+
+	if (x->order != y->order)
+		return x->order < y->order ? -1 : 1;
+
+	return x->reg - y->reg;
+}
+
+/* Optimize the DSP page writes between two writes to page 0 */
+static size_t acmfw_optimize_run(struct acmfw_write *w, size_t n,
+				 bool reorder)
+{
+	static bool seen[256][256];
+	size_t i, out;
+
+	/* Walk backwards so that the last write to a register survives */
+	for (i = n; i-- > 0; ) {
+		if (seen[w[i].page][w[i].reg]) {
+			w[i].page = 0;
+			continue;
+		}
+		seen[w[i].page][w[i].reg] = true;
+	}
+
+	for (i = 0, out = 0; i < n; i++) {
+		if (!w[i].page)
+			continue;
+		seen[w[i].page][w[i].reg] = false;
+		w[out++] = w[i];
+	}
+
+	/* Registers are unique now, so the sort needs no stability */
+	if (reorder)
+		qsort(w, out, sizeof(*w), acmfw_cmp);
+
+	return out;
+}
+
+static size_t acmfw_optimize(struct acmfw_write *w, size_t n, bool reorder)
+{
+	size_t i = 0, start, out = 0;
+
+	while (i < n) {
+		if (!w[i].page) {
+			w[out++] = w[i++];
+			continue;
+		}
+
+		for (start = i; i < n && w[i].page; i++)
+			;
+
+		memmove(w + out, w + start, (i - start) * sizeof(*w));
+		out += acmfw_optimize_run(w + out, i - start, reorder);
+	}
+
+	return out;
+}
+
+/* Split the writes into page selects and runs of consecutive registers.
+ * Page 0 writes go out one at a time, as the drivers do.
+ */
+static size_t acmfw_segment(const struct acmfw_write *w, size_t n,
+			    uint8_t end_page, unsigned int max_burst,
+			    struct acmfw_seg *seg)
+{
+	struct acmfw_seg *last = NULL;
+	uint8_t page = 0;
+	size_t i, num = 0;
+
+	for (i = 0; i < n; i++) {
+		if (w[i].page != page) {
+			page = w[i].page;
+			seg[num++] = (struct acmfw_seg){ page, REG_PAGE, 1,
+							 NULL };
+			last = NULL;
+		}
+
+		if (last && page && last->reg + last->len == w[i].reg &&
+		    (!max_burst || last->len < max_burst)) {
+			last->len++;
+			continue;
+		}
+
+		last = &seg[num++];
+		*last = (struct acmfw_seg){ page, w[i].reg, 1, &w[i] };
+	}
+
+	if (page != end_page)
+		seg[num++] = (struct acmfw_seg){ end_page, REG_PAGE, 1, NULL };
+
+	return num;
+}
+
+static void acmfw_print_cost(const char *name, const struct acmfw_cost *cost)
+{
+	size_t i;
+
+	printf("%-8s %7lu %7lu", name, cost->xfers, cost->bytes);
+	for (i = 0; i < sizeof(acmfw_freqs) / sizeof(acmfw_freqs[0]); i++)
+		printf(" %10.1f", cost->bits * 1e6 / acmfw_freqs[i]);
+	printf("\n");
+}
+
+static int acmfw_write_blob(const char *name, const uint8_t *curve,
+			    size_t curve_len, const struct acmfw_seg *seg,
+			    size_t num)
+{
+	unsigned int j;
+	size_t i;
+	FILE *f;
+
+	f = fopen(name, "wb");
+	if (!f)
+		return -errno;
+
+	fwrite(curve, 1, curve_len, f);
+
+	for (i = 0; i < num; i++) {
+		if (seg[i].reg == REG_PAGE) {
+			fputc(REG_PAGE, f);
+			fputc(seg[i].page, f);
+			continue;
+		}
+
+		for (j = 0; j < seg[i].len; j++) {
+			fputc(seg[i].w[j].reg, f);
+			fputc(seg[i].w[j].val, f);
+		}
+	}
+
+	if (fclose(f))
+		return -errno;
+
+	return 0;
+}
+
+static void acmfw_list(const struct acmfw_seg *seg, size_t num)
+{
+	unsigned int j;
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (seg[i].reg == REG_PAGE) {
+			printf("page 0x%02x\n", seg[i].page);
+			continue;
+		}
+
+		printf("  0x%02x %3u:", seg[i].reg, seg[i].len);
+		for (j = 0; j < seg[i].len; j++)
+			printf("%s%02x", j && !(j % 16) ? "\n           " : " ",
+			       seg[i].w[j].val);
+		printf("\n");
+	}
+}
+
+static void acmfw_usage(FILE *f, const char *prog)
+{
+	fprintf(f,
+"usage: %s [options] BLOB\n"
+"\n"
+"Optimizes a DSP configuration blob from the ACME Audio Tuning tool and\n"
+"reports its bus cost before and after.\n"
+"\n"
+"  -o, --output FILE        write the optimized blob to FILE\n"
+"  -R, --no-reorder         keep the order of the writes, only drop\n"
+"                           overridden writes and page selects\n"
+"  -b, --max-burst N        limit burst segments to N registers\n"
+"  -l, --list               list the burst segments\n"
+"  -h, --help\n",
+		prog);
+}
+
+static const struct option acmfw_options[] = {
+	{ "output",	required_argument,	NULL, 'o' },
+	{ "no-reorder",	no_argument,		NULL, 'R' },
+	{ "max-burst",	required_argument,	NULL, 'b' },
+	{ "list",	no_argument,		NULL, 'l' },
+	{ "help",	no_argument,		NULL, 'h' },
+	{ }
+};
+
+int main(int argc, char **argv)
+{
+	struct acmfw_cost in = { 0 }, pairs = { 0 }, bursts = { 0 };
+	const char *output = NULL;
+	unsigned int max_burst = 0;
+	bool reorder = true, list = false;
+	struct acmfw_write *w;
+	struct acmfw_seg *seg;
+	size_t len, n, num, i, j;
+	uint8_t *blob, *body, end_page;
+	long curve_len;
+	int opt, ret;
+
+	while ((opt = getopt_long(argc, argv, "o:Rb:lh", acmfw_options,
+				  NULL)) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'R':
+			reorder = false;
+			break;
+		case 'b':
+			max_burst = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			list = true;
+			break;
+		case 'h':
+			acmfw_usage(stdout, argv[0]);
+			return 0;
+		default:
+			acmfw_usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind != argc - 1) {
+		acmfw_usage(stderr, argv[0]);
+		return 2;
+	}
+
+	blob = acmfw_read_file(argv[optind], &len);
+	if (!blob) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	/* Same checks as the drivers */
+	curve_len = acmfw_curve_len(blob, len);
+	if (curve_len < 0) {
+		fprintf(stderr, "%s: bad volume curve\n", argv[optind]);
+		return 1;
+	}
+	body = blob + curve_len;
+	len -= curve_len;
+
+	if (len < 2 || len & 1) {
+		fprintf(stderr, "%s: bad size %zu\n", argv[optind], len);
+		return 1;
+	}
+
+	for (i = 0; i < len; i += 2)
+		acmfw_account(&in, 1);
+
+	w = acmfw_parse(body, len, &n, &end_page);
+	if (!w) {
+		perror("acmfw");
+		return 1;
+	}
+
+	n = acmfw_optimize(w, n, reorder);
+
+	/* At worst a page select before and after every write */
+	seg = calloc(2 * n + 1, sizeof(*seg));
+	if (!seg) {
+		perror("acmfw");
+		return 1;
+	}
+	num = acmfw_segment(w, n, end_page, max_burst, seg);
+
+	for (i = 0; i < num; i++) {
+		acmfw_account(&bursts, seg[i].len);
+		for (j = 0; j < seg[i].len; j++)
+			acmfw_account(&pairs, 1);
+	}
+
+	if (list) {
+		if (curve_len)
+			printf("volume %u steps of %u from %d (0.01 dB)\n",
+			       acmfw_le(blob + 4, 2), acmfw_le(blob + 6, 2),
+			       (int32_t)acmfw_le(blob + 8, 4));
+		acmfw_list(seg, num);
+	}
+
+	printf("%-8s %7s %7s %10s %10s %10s\n", "", "xfers", "bytes",
+	       "100k_us", "400k_us", "1M_us");
+	acmfw_print_cost("input", &in);
+	acmfw_print_cost("pairs", &pairs);
+	acmfw_print_cost("bursts", &bursts);
+
+	if (output) {
+		ret = acmfw_write_blob(output, blob, curve_len, seg, num);
+		if (ret) {
+			fprintf(stderr, "%s: %s\n", output, strerror(-ret));
+			return 1;
+		}
+	}
+
+	free(seg);
+	free(w);
+	free(blob);
+
+	return 0;
+}
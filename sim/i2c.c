@@ -0,0 +1,395 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Simulated I2C bus and amplifier register file.
+//
+// Every regmap access becomes one bus transaction. Its duration is
+// derived from the bit count at the configured clock, plus a fixed
+// per-transaction overhead for the adapter, and advances the virtual
+// clock. Addresses are resolved to amplifiers, including broadcast
+// group addresses which every member acknowledges.
+//
+
+#include "sim.h"
+
+struct sim_bus_cfg sim_bus = {
+	.freq_hz	= 400000,
+};
+
+struct sim_io sim_io;
+
+struct sim_amp sim_amps[SIM_MAX_AMPS];
+int sim_num_amps;
+
+/* Register layout of page 0. DEVICE_STATE keeps the state in the low
+ * bits and mute above it; the ACM8831 calls it CH1_STATE.
+ */
+static const struct sim_chip sim_chips[] = {
+	{ "acm8615",  0x04, 0x03, 0x02, 0x03, 0x16, 0x17, 3, 0 },
+	{ "acm8623",  0x04, 0x03, 0x02, 0x03, 0x16, 0x17, 3, 0 },
+	{ "acm8625p", 0x04, 0x03, 0x02, 0x03, 0x16, 0x17, 3, 0 },
+	{ "acm8625s", 0x04, 0x03, 0x02, 0x03, 0x16, 0x17, 3, 0 },
+	{ "acm8635",  0x04, 0x03, 0x02, 0x03, 0x16, 0x17, 3, 0 },
+	{ "acm8831",  0x09, 0x07, 0x04, 0x05, 0,    0x60, 11, 0x6b },
+};
+
+#define SIM_MAX_FAIL	16
+
+/* Ranges of transactions to fail, first and last included */
+static u64 sim_fail[SIM_MAX_FAIL][2];
+static int sim_num_fail;
+
+int sim_fail_xfer(u64 first, u64 last)
+{
+	if (sim_num_fail == SIM_MAX_FAIL)
+		return -ENOSPC;
+
+	sim_fail[sim_num_fail][0] = first;
+	sim_fail[sim_num_fail][1] = last;
+	sim_num_fail++;
+	return 0;
+}
+
+const struct sim_chip *sim_chip_find(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(sim_chips); i++)
+		if (!strcmp(sim_chips[i].name, name))
+			return &sim_chips[i];
+
+	return NULL;
+}
+
+struct sim_amp *sim_amp_add(const struct sim_chip *chip, unsigned short addr,
+			    unsigned short group)
+{
+	struct sim_amp *amp;
+
+	if (sim_num_amps == SIM_MAX_AMPS)
+		return NULL;
+
+	amp = &sim_amps[sim_num_amps++];
+	memset(amp, 0, sizeof(*amp));
+	amp->chip = chip;
+	amp->addr = addr;
+	amp->group = group;
+	amp->irq = sim_num_amps;
+	amp->temp = 40;
+	amp->play_time = -1;
+
+	return amp;
+}
+
+struct sim_amp *sim_amp_find(unsigned short addr)
+{
+	int i;
+
+	for (i = 0; i < sim_num_amps; i++)
+		if (sim_amps[i].addr == addr)
+			return &sim_amps[i];
+
+	return NULL;
+}
+
+static unsigned int sim_amp_state(const struct sim_amp *amp)
+{
+	return amp->regs[0][amp->chip->state_reg] & amp->chip->state_mask;
+}
+
+bool sim_amp_playing(const struct sim_amp *amp)
+{
+	return sim_amp_state(amp) == amp->chip->state_play;
+}
+
+static bool sim_is_fault_reg(const struct sim_chip *chip, unsigned int reg)
+{
+	return reg >= chip->fault_reg && reg < chip->fault_reg + chip->fault_len;
+}
+
+static void sim_amp_set_state(struct sim_amp *amp, u8 val)
+{
+	const struct sim_chip *chip = amp->chip;
+	unsigned int old = sim_amp_state(amp);
+	unsigned int new = val & chip->state_mask;
+
+	/* Going through Hi-Z clears a latched fault once the condition
+	 * behind it has gone. Until then the output stays in Hi-Z.
+	 */
+	if (amp->fault_latched) {
+		if (new == chip->state_hiz && sim_now >= amp->fault_until) {
+			amp->fault_latched = false;
+			memset(&amp->regs[0][chip->fault_reg], 0, chip->fault_len);
+		} else if (new > chip->state_hiz) {
+			new = chip->state_hiz;
+		}
+	}
+
+	amp->regs[0][chip->state_reg] = (val & ~chip->state_mask) | new;
+	if (chip->report_reg)
+		amp->regs[0][chip->report_reg] = new;
+
+	if (new != old)
+		amp->transitions++;
+	if (!new)
+		amp->resets++;
+
+	/* Latency counts to the last entry into PLAY. A warm start may
+	 * find the amplifier still playing, in which case the first PLAY
+	 * written after the trigger counts.
+	 */
+	if (new == chip->state_play &&
+	    (new != old || amp->play_time < sim_card.trigger_time))
+		amp->play_time = sim_now;
+}
+
+void sim_amp_fault(struct sim_amp *amp, u8 val, unsigned int hold_ms)
+{
+	const struct sim_chip *chip = amp->chip;
+	unsigned int state = sim_amp_state(amp);
+
+	/* Drop to Hi-Z before latching, or the transition clears it */
+	if (state > chip->state_hiz)
+		sim_amp_set_state(amp, (amp->regs[0][chip->state_reg] &
+					~chip->state_mask) | chip->state_hiz);
+
+	amp->fault_latched = true;
+	amp->fault_val = val;
+	amp->fault_until = sim_now + (s64)hold_ms * NSEC_PER_MSEC;
+	amp->regs[0][chip->fault_reg] = val;
+
+	if (sim_gpio.fault_pin)
+		sim_irq_raise(amp->irq);
+}
+
+static void sim_amp_write(struct sim_amp *amp, unsigned int reg, u8 val)
+{
+	const struct sim_chip *chip = amp->chip;
+
+	if (!reg) {
+		amp->page = val;
+		return;
+	}
+
+	if (amp->page) {
+		amp->regs[amp->page][reg] = val;
+		return;
+	}
+
+	/* Status registers on page 0 are read only */
+	if (reg == chip->state_reg)
+		sim_amp_set_state(amp, val);
+	else if (reg != chip->report_reg && !sim_is_fault_reg(chip, reg) &&
+		 reg != chip->temp_reg)
+		amp->regs[0][reg] = val;
+}
+
+static u8 sim_amp_read(struct sim_amp *amp, unsigned int reg)
+{
+	if (!reg)
+		return amp->page;
+
+	if (!amp->page && amp->chip->temp_reg && reg == amp->chip->temp_reg)
+		return amp->temp;
+
+	return amp->regs[amp->page][reg];
+}
+
+/* Account for one transaction of the given number of bits. Returns
+ * -EREMOTEIO if it was chosen to fail, in which case only the address
+ * byte made it onto the bus.
+ */
+static int sim_bus_xfer(unsigned int bits)
+{
+	u64 n = ++sim_io.xfers;
+	s64 ns;
+	int i;
+
+	for (i = 0; i < sim_num_fail; i++)
+		if (n >= sim_fail[i][0] && n <= sim_fail[i][1])
+			bits = 9 + 2;
+
+	ns = (s64)bits * NSEC_PER_SEC / sim_bus.freq_hz + sim_bus.overhead_ns;
+	sim_io.bus_ns += ns;
+	sim_now += ns;
+
+	if (bits == 9 + 2) {
+		sim_io.errors++;
+		return -EREMOTEIO;
+	}
+
+	return 0;
+}
+
+/* START, address, register, data..., STOP */
+static int sim_bus_write(unsigned short addr, unsigned int reg,
+			 const u8 *val, size_t len)
+{
+	bool acked = false;
+	size_t i;
+	int a, ret;
+
+	ret = sim_bus_xfer((2 + len) * 9 + 2);
+	if (ret)
+		return ret;
+
+	sim_io.writes++;
+	sim_io.bytes += 1 + len;
+	if (!reg)
+		sim_io.page_switches++;
+
+	for (a = 0; a < sim_num_amps; a++) {
+		struct sim_amp *amp = &sim_amps[a];
+
+		if (amp->addr != addr && (!amp->group || amp->group != addr))
+			continue;
+
+		acked = true;
+		for (i = 0; i < len; i++)
+			sim_amp_write(amp, (reg + i) & 0xff, val[i]);
+	}
+
+	return acked ? 0 : -ENXIO;
+}
+
+/* START, address, register, repeated START, address, data..., STOP.
+ * Only one device may answer, so group addresses cannot be read.
+ */
+static int sim_bus_read(unsigned short addr, unsigned int reg, u8 *val,
+			size_t len)
+{
+	struct sim_amp *amp = sim_amp_find(addr);
+	size_t i;
+	int ret;
+
+	ret = sim_bus_xfer((3 + len) * 9 + 3);
+	if (ret)
+		return ret;
+
+	sim_io.reads++;
+	sim_io.bytes += 1 + len;
+
+	if (!amp)
+		return -ENXIO;
+
+	for (i = 0; i < len; i++)
+		val[i] = sim_amp_read(amp, (reg + i) & 0xff);
+
+	return 0;
+}
+
+/* I2C clients */
+struct i2c_client *i2c_new_dummy_device(struct i2c_adapter *adapter,
+					u16 address)
+{
+	struct i2c_client *client = calloc(1, sizeof(*client));
+
+	if (!client)
+		return ERR_PTR(-ENOMEM);
+
+	client->addr = address;
+	client->adapter = adapter;
+	snprintf(client->name, sizeof(client->name), "dummy-%02x", address);
+	client->dev.name = client->name;
+	INIT_LIST_HEAD(&client->dev.devres);
+
+	return client;
+}
+
+void i2c_unregister_device(struct i2c_client *client)
+{
+	if (IS_ERR_OR_NULL(client))
+		return;
+
+	sim_devres_release(&client->dev);
+	free(client);
+}
+
+/* regmap, 8 bit registers and values, no cache */
+struct regmap {
+	struct i2c_client	*client;
+};
+
+struct regmap *regmap_init_i2c(struct i2c_client *i2c,
+			       const struct regmap_config *config)
+{
+	struct regmap *map;
+
+	if (config->reg_bits != 8 || config->val_bits != 8)
+		return ERR_PTR(-EINVAL);
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		return ERR_PTR(-ENOMEM);
+
+	map->client = i2c;
+	return map;
+}
+
+struct regmap *devm_regmap_init_i2c(struct i2c_client *i2c,
+				    const struct regmap_config *config)
+{
+	struct regmap *map;
+
+	if (config->reg_bits != 8 || config->val_bits != 8)
+		return ERR_PTR(-EINVAL);
+
+	map = devm_kzalloc(&i2c->dev, sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return ERR_PTR(-ENOMEM);
+
+	map->client = i2c;
+	return map;
+}
+
+void regmap_exit(struct regmap *map)
+{
+	free(map);
+}
+
+int regmap_write(struct regmap *map, unsigned int reg, unsigned int val)
+{
+	u8 v = val;
+
+	return sim_bus_write(map->client->addr, reg, &v, 1);
+}
+
+int regmap_bulk_write(struct regmap *map, unsigned int reg, const void *val,
+		      size_t val_count)
+{
+	return sim_bus_write(map->client->addr, reg, val, val_count);
+}
+
+int regmap_read(struct regmap *map, unsigned int reg, unsigned int *val)
+{
+	u8 v;
+	int ret;
+
+	ret = sim_bus_read(map->client->addr, reg, &v, 1);
+	if (!ret)
+		*val = v;
+
+	return ret;
+}
+
+int regmap_bulk_read(struct regmap *map, unsigned int reg, void *val,
+		     size_t val_count)
+{
+	return sim_bus_read(map->client->addr, reg, val, val_count);
+}
+
+int regmap_update_bits(struct regmap *map, unsigned int reg,
+		       unsigned int mask, unsigned int val)
+{
+	unsigned int old, new;
+	int ret;
+
+	ret = regmap_read(map, reg, &old);
+	if (ret)
+		return ret;
+
+	new = (old & ~mask) | (val & mask);
+	if (new == old)
+		return 0;
+
+	return regmap_write(map, reg, new);
+}
@@ -0,0 +1,1098 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Userspace stand-ins for the kernel and ASoC interfaces used by the
+ * amplifier drivers, so each driver can be compiled unmodified and run
+ * against the simulated register file. Only what the drivers use is
+ * provided, and only as far as the simulator needs it.
+ */
+#ifndef KSIM_H
+#define KSIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef long long s64;
+typedef unsigned int gfp_t;
+typedef unsigned short umode_t;
+
+#define U32_MAX		((u32)~0U)
+#define U64_MAX		((u64)~0ULL)
+
+#define GFP_KERNEL	0
+
+#define __user
+#define __init
+#define __exit
+#define __always_unused	__attribute__((unused))
+#define __maybe_unused	__attribute__((unused))
+#define fallthrough	__attribute__((fallthrough))
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+/* Kconfig: options are enabled with -DCONFIG_FOO=1 */
+#define __ARG_PLACEHOLDER_1 0,
+#define __take_second_arg(__ignored, val, ...) val
+#define __is_defined(x)			___is_defined(x)
+#define ___is_defined(val)		____is_defined(__ARG_PLACEHOLDER_##val)
+#define ____is_defined(arg1_or_junk)	__take_second_arg(arg1_or_junk 1, 0)
+#define IS_ENABLED(option)		__is_defined(option)
+#define IS_REACHABLE(option)		__is_defined(option)
+
+#define BIT(n)			(1UL << (n))
+#define GENMASK(h, l)		(((~0UL) << (l)) & (~0UL >> (63 - (h))))
+#define BIT_ULL(n)		(1ULL << (n))
+#define GENMASK_ULL(h, l)	(((~0ULL) << (l)) & (~0ULL >> (63 - (h))))
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define DIV_ROUND_CLOSEST(x, d)	((x) >= 0 ? ((x) + (d) / 2) / (d) : \
+				 ((x) - (d) / 2) / (d))
+#define BITS_PER_LONG		64
+#define BITS_TO_LONGS(n)	DIV_ROUND_UP(n, BITS_PER_LONG)
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define max(a, b)		((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)		((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b)		((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define clamp(v, lo, hi)	min(max(v, lo), hi)
+#define clamp_t(t, v, lo, hi)	min_t(t, max_t(t, v, lo), hi)
+
+#define READ_ONCE(x)		(*(volatile __typeof__(x) *)&(x))
+#define WRITE_ONCE(x, v)	(*(volatile __typeof__(x) *)&(x) = (v))
+
+#define MAX_ERRNO	4095
+#define IS_ERR_VALUE(x)	((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error) { return (void *)error; }
+static inline long PTR_ERR(const void *ptr) { return (long)ptr; }
+static inline bool IS_ERR(const void *ptr) { return IS_ERR_VALUE(ptr); }
+static inline bool IS_ERR_OR_NULL(const void *ptr)
+{
+	return !ptr || IS_ERR_VALUE(ptr);
+}
+
+static inline int fls(unsigned int x)
+{
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline s64 div_s64(s64 dividend, s32 divisor)
+{
+	return dividend / divisor;
+}
+
+void *memchr_inv(const void *s, int c, size_t n);
+size_t strscpy(char *dest, const char *src, size_t count);
+
+/* module */
+struct module;
+extern struct module __this_module;
+#define THIS_MODULE		(&__this_module)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_LICENSE(x)
+#define MODULE_DEVICE_TABLE(type, name)
+#define MODULE_PARM_DESC(name, desc)
+
+/* Module parameters land in a section so the simulator can set them
+ * from the command line.
+ */
+enum sim_param_type {
+	SIM_PARAM_int,
+	SIM_PARAM_uint,
+	SIM_PARAM_bool,
+};
+
+struct sim_param {
+	const char		*name;
+	void			*value;
+	enum sim_param_type	type;
+};
+
+#define module_param(name, type, perm)					\
+	static const struct sim_param __sim_param_##name		\
+	__attribute__((used, section("sim_params"), aligned(8))) =	\
+		{ #name, &name, SIM_PARAM_##type }
+
+/* printk */
+#define KERN_ERR	"3"
+#define KERN_WARNING	"4"
+#define KERN_INFO	"6"
+#define KERN_DEBUG	"7"
+
+struct device;
+
+void sim_dev_printk(const char *level, const struct device *dev,
+		    const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+#define dev_err(dev, ...)	sim_dev_printk(KERN_ERR, dev, __VA_ARGS__)
+#define dev_warn(dev, ...)	sim_dev_printk(KERN_WARNING, dev, __VA_ARGS__)
+#define dev_info(dev, ...)	sim_dev_printk(KERN_INFO, dev, __VA_ARGS__)
+#define dev_dbg(dev, ...)	sim_dev_printk(KERN_DEBUG, dev, __VA_ARGS__)
+#define pr_err(...)		sim_dev_printk(KERN_ERR, NULL, __VA_ARGS__)
+#define pr_warn(...)		sim_dev_printk(KERN_WARNING, NULL, __VA_ARGS__)
+#define pr_info(...)		sim_dev_printk(KERN_INFO, NULL, __VA_ARGS__)
+#define pr_debug(...)		sim_dev_printk(KERN_DEBUG, NULL, __VA_ARGS__)
+
+/* lists */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+#define LIST_HEAD(name)		struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void list_add_tail(struct list_head *entry,
+				 struct list_head *head)
+{
+	entry->prev = head->prev;
+	entry->next = head;
+	head->prev->next = entry;
+	head->prev = entry;
+}
+
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+	entry->next = head->next;
+	entry->prev = head;
+	head->next->prev = entry;
+	head->next = entry;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	entry->next = entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	INIT_LIST_HEAD(entry);
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+#define list_first_entry(head, type, member) \
+	list_entry((head)->next, type, member)
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, __typeof__(*(pos)), member)
+#define list_for_each_entry(pos, head, member)				\
+	for (pos = list_first_entry(head, __typeof__(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_next_entry(pos, member))
+#define list_for_each_entry_safe(pos, n, head, member)			\
+	for (pos = list_first_entry(head, __typeof__(*pos), member),	\
+	     n = list_next_entry(pos, member);				\
+	     &pos->member != (head);					\
+	     pos = n, n = list_next_entry(n, member))
+
+/* Sorting */
+typedef int (*cmp_func_t)(const void *a, const void *b);
+typedef void (*swap_func_t)(void *a, void *b, int size);
+
+void sort(void *base, size_t num, size_t size, cmp_func_t cmp_func,
+	  swap_func_t swap_func);
+
+/* Bitmaps */
+#define DECLARE_BITMAP(name, bits)	unsigned long name[BITS_TO_LONGS(bits)]
+
+void bitmap_zero(unsigned long *dst, unsigned int nbits);
+void bitmap_fill(unsigned long *dst, unsigned int nbits);
+void bitmap_set(unsigned long *map, unsigned int start, unsigned int nbits);
+void bitmap_clear(unsigned long *map, unsigned int start, unsigned int nbits);
+void bitmap_or(unsigned long *dst, const unsigned long *src1,
+	       const unsigned long *src2, unsigned int nbits);
+unsigned int bitmap_weight(const unsigned long *src, unsigned int nbits);
+bool bitmap_subset(const unsigned long *src1, const unsigned long *src2,
+		   unsigned int nbits);
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+			    unsigned long offset);
+unsigned long find_next_zero_bit(const unsigned long *addr,
+				 unsigned long size, unsigned long offset);
+unsigned long find_last_bit(const unsigned long *addr, unsigned long size);
+
+#define find_first_bit(addr, size)	find_next_bit(addr, size, 0)
+#define for_each_set_bit(bit, addr, size)				\
+	for ((bit) = find_first_bit((addr), (size));			\
+	     (bit) < (size);						\
+	     (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+static inline void __set_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline bool test_bit(unsigned long nr, const unsigned long *addr)
+{
+	return addr[nr / BITS_PER_LONG] & (1UL << (nr % BITS_PER_LONG));
+}
+
+u32 xxh32(const void *input, size_t len, u32 seed);
+
+/* Drivers and userspace share one address space */
+static inline unsigned long copy_to_user(void __user *to, const void *from,
+					 unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline u64 mul_u64_u64_shr(u64 a, u64 mul, unsigned int shift)
+{
+	return (u64)(((unsigned __int128)a * mul) >> shift);
+}
+
+static inline u16 get_unaligned_le16(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8;
+}
+
+static inline u32 get_unaligned_le32(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8 | b[2] << 16 | (u32)b[3] << 24;
+}
+
+static inline u64 get_unaligned_le64(const void *p)
+{
+	return get_unaligned_le32(p) |
+	       (u64)get_unaligned_le32((const u8 *)p + 4) << 32;
+}
+
+/* LZ4 blocks decode, with a dictionary only right in front of dest */
+int LZ4_decompress_safe(const char *source, char *dest, int compressed_size,
+			int max_decompressed_size);
+int LZ4_decompress_safe_usingDict(const char *source, char *dest,
+				  int compressed_size, int max_output_size,
+				  const char *dict_start, int dict_size);
+
+/* There is no zstd decoder; every frame fails to parse */
+#define ZSTD_CONTENTSIZE_UNKNOWN	(0ULL - 1)
+
+typedef struct {
+	unsigned long long	frameContentSize;
+} zstd_frame_header;
+
+typedef struct zstd_dctx zstd_dctx;
+
+size_t zstd_get_frame_header(zstd_frame_header *params, const void *src,
+			     size_t src_size);
+size_t zstd_dctx_workspace_bound(void);
+zstd_dctx *zstd_init_dctx(void *workspace, size_t workspace_size);
+size_t zstd_decompress_dctx(zstd_dctx *dctx, void *dst, size_t dst_capacity,
+			    const void *src, size_t src_size);
+unsigned int zstd_is_error(size_t code);
+u32 get_random_u32(void);
+
+/* time: a virtual clock that only moves when the driver sleeps or
+ * the bus is busy
+ */
+typedef s64 ktime_t;
+
+#define NSEC_PER_USEC	1000L
+#define NSEC_PER_MSEC	1000000L
+#define NSEC_PER_SEC	1000000000L
+#define HZ		1000
+
+ktime_t ktime_get(void);
+
+#define ktime_sub(a, b)		((a) - (b))
+#define ktime_add(a, b)		((a) + (b))
+#define ktime_add_ms(kt, ms)	((kt) + (s64)(ms) * NSEC_PER_MSEC)
+#define ktime_to_ns(kt)		((s64)(kt))
+#define ktime_to_us(kt)		((s64)(kt) / NSEC_PER_USEC)
+#define ktime_to_ms(kt)		((s64)(kt) / NSEC_PER_MSEC)
+#define ns_to_ktime(ns)		((ktime_t)(ns))
+#define ms_to_ktime(ms)		((ktime_t)(ms) * NSEC_PER_MSEC)
+
+static inline s64 ktime_us_delta(ktime_t later, ktime_t earlier)
+{
+	return ktime_to_us(later - earlier);
+}
+
+static inline s64 ktime_ms_delta(ktime_t later, ktime_t earlier)
+{
+	return ktime_to_ms(later - earlier);
+}
+
+static inline unsigned long msecs_to_jiffies(unsigned int m)
+{
+	return m;
+}
+
+static inline unsigned int jiffies_to_msecs(unsigned long j)
+{
+	return j;
+}
+
+void usleep_range(unsigned long min, unsigned long max);
+void msleep(unsigned int msecs);
+void udelay(unsigned long usecs);
+#define mdelay(n)	udelay((n) * 1000UL)
+#define fsleep(us)	usleep_range(us, 2 * (us))
+
+/* Locking. There is a single thread, so a mutex only checks that it
+ * is not taken twice.
+ */
+struct mutex {
+	bool		held;
+};
+
+#define DEFINE_MUTEX(name)	struct mutex name = { false }
+
+void mutex_init(struct mutex *lock);
+void mutex_lock(struct mutex *lock);
+void mutex_unlock(struct mutex *lock);
+#define mutex_destroy(lock)	((void)(lock))
+#define mutex_is_locked(lock)	((lock)->held)
+#define lockdep_assert_held(lock)	((void)(lock))
+
+/* Work items run from the simulator's event loop */
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	struct list_head	entry;
+	work_func_t		func;
+	bool			pending;
+	bool			running;
+	bool			delayed;
+};
+
+/* A point on the virtual clock at which the simulator calls fn */
+struct sim_timer {
+	struct list_head	node;
+	ktime_t			expires;
+	void			(*fn)(struct sim_timer *timer);
+	bool			pending;
+};
+
+struct delayed_work {
+	struct work_struct	work;
+	struct sim_timer	timer;
+};
+
+struct workqueue_struct;
+extern struct workqueue_struct *system_wq;
+extern struct workqueue_struct *system_unbound_wq;
+extern struct workqueue_struct *system_power_efficient_wq;
+
+void INIT_WORK(struct work_struct *work, work_func_t func);
+void INIT_DELAYED_WORK(struct delayed_work *dwork, work_func_t func);
+
+#define to_delayed_work(w)	container_of(w, struct delayed_work, work)
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+bool cancel_work_sync(struct work_struct *work);
+bool flush_work(struct work_struct *work);
+bool queue_delayed_work(struct workqueue_struct *wq,
+			struct delayed_work *dwork, unsigned long delay);
+bool mod_delayed_work(struct workqueue_struct *wq,
+		      struct delayed_work *dwork, unsigned long delay);
+bool cancel_delayed_work(struct delayed_work *dwork);
+bool cancel_delayed_work_sync(struct delayed_work *dwork);
+#define schedule_work(w)	queue_work(system_wq, w)
+#define schedule_delayed_work(w, d) \
+	queue_delayed_work(system_wq, w, d)
+
+/* Waiting runs other queued work items until the condition holds,
+ * then gives up after the timeout of virtual time.
+ */
+typedef struct {
+	int		unused;
+} wait_queue_head_t;
+
+#define init_waitqueue_head(wq)	((void)(wq))
+#define wake_up(wq)		((void)(wq))
+#define wake_up_all(wq)		((void)(wq))
+
+bool sim_wait_step(void);
+void sim_sleep_ns(s64 ns);
+
+#define wait_event_timeout(wq, condition, timeout)			\
+({									\
+	long __ret = (timeout);						\
+	(void)(wq);							\
+	while (!(condition) && sim_wait_step())				\
+		;							\
+	if (!(condition)) {						\
+		sim_sleep_ns((s64)__ret * NSEC_PER_MSEC);		\
+		__ret = (condition) ? 1 : 0;				\
+	}								\
+	__ret;								\
+})
+
+/* memory */
+void *kmalloc(size_t size, gfp_t flags);
+void *kzalloc(size_t size, gfp_t flags);
+void *kcalloc(size_t n, size_t size, gfp_t flags);
+void *kmemdup(const void *src, size_t len, gfp_t flags);
+void kfree(const void *ptr);
+#define kmalloc_array(n, size, flags)	kcalloc(n, size, flags)
+#define kvmalloc(size, flags)		kmalloc(size, flags)
+#define kvzalloc(size, flags)		kzalloc(size, flags)
+#define kvfree(ptr)			kfree(ptr)
+
+/* devices */
+struct device_node;
+
+struct sim_prop {
+	const char		*name;
+	const char		*str;
+	u32			val;
+	const char * const	*strv;		/* NULL terminated */
+};
+
+struct device {
+	const char		*name;
+	void			*driver_data;
+	struct device_node	*of_node;
+	const struct sim_prop	*props;
+	struct list_head	devres;
+};
+
+static inline const char *dev_name(const struct device *dev)
+{
+	return dev->name;
+}
+
+static inline void dev_set_drvdata(struct device *dev, void *data)
+{
+	dev->driver_data = data;
+}
+
+static inline void *dev_get_drvdata(const struct device *dev)
+{
+	return dev->driver_data;
+}
+
+void *devm_kmalloc(struct device *dev, size_t size, gfp_t gfp);
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp);
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t gfp);
+void *devm_kmemdup(struct device *dev, const void *src, size_t len,
+		   gfp_t gfp);
+void devm_kfree(struct device *dev, const void *p);
+
+/* sysfs attributes, only reachable through sim_dev_attr_store() */
+struct attribute {
+	const char		*name;
+	umode_t			mode;
+};
+
+struct attribute_group {
+	const char		*name;
+	struct attribute	**attrs;
+};
+
+struct device_attribute {
+	struct attribute	attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count);
+};
+
+#define DEVICE_ATTR_WO(_name)						\
+	struct device_attribute dev_attr_##_name = {			\
+		.attr	= { .name = #_name, .mode = 0200 },		\
+		.store	= _name##_store,				\
+	}
+
+#define ATTRIBUTE_GROUPS(_name)						\
+	static const struct attribute_group _name##_group = {		\
+		.attrs	= _name##_attrs,				\
+	};								\
+	static const struct attribute_group *_name##_groups[] = {	\
+		&_name##_group,						\
+		NULL							\
+	}
+
+bool device_property_present(struct device *dev, const char *propname);
+int device_property_read_u32(struct device *dev, const char *propname,
+			     u32 *val);
+int device_property_read_string(struct device *dev, const char *propname,
+				const char **val);
+int device_property_read_string_array(struct device *dev,
+				      const char *propname, const char **val,
+				      size_t nval);
+
+/* of */
+struct of_device_id {
+	char			compatible[128];
+	const void		*data;
+};
+
+#define of_match_ptr(ptr)	NULL
+
+/* I2C */
+struct i2c_adapter {
+	int			nr;
+};
+
+struct i2c_client {
+	unsigned short		addr;
+	char			name[20];
+	struct i2c_adapter	*adapter;
+	struct device		dev;
+	int			irq;
+};
+
+struct i2c_device_id {
+	char			name[20];
+	unsigned long		driver_data;
+};
+
+struct device_driver {
+	const char		*name;
+	const struct of_device_id *of_match_table;
+	const struct attribute_group **dev_groups;
+};
+
+struct i2c_driver {
+	int (*probe_new)(struct i2c_client *client);
+	void (*remove)(struct i2c_client *client);
+	struct device_driver	driver;
+	const struct i2c_device_id *id_table;
+};
+
+#define module_i2c_driver(__i2c_driver) \
+	struct i2c_driver *sim_i2c_driver = &(__i2c_driver)
+
+struct i2c_client *i2c_new_dummy_device(struct i2c_adapter *adapter,
+					u16 address);
+void i2c_unregister_device(struct i2c_client *client);
+
+/* regmap */
+enum regcache_type {
+	REGCACHE_NONE,
+	REGCACHE_RBTREE,
+	REGCACHE_FLAT,
+};
+
+struct regmap_config {
+	const char		*name;
+	int			reg_bits;
+	int			val_bits;
+	unsigned int		max_register;
+	enum regcache_type	cache_type;
+};
+
+struct regmap;
+
+struct regmap *regmap_init_i2c(struct i2c_client *i2c,
+			       const struct regmap_config *config);
+struct regmap *devm_regmap_init_i2c(struct i2c_client *i2c,
+				    const struct regmap_config *config);
+void regmap_exit(struct regmap *map);
+int regmap_write(struct regmap *map, unsigned int reg, unsigned int val);
+int regmap_read(struct regmap *map, unsigned int reg, unsigned int *val);
+int regmap_bulk_write(struct regmap *map, unsigned int reg, const void *val,
+		      size_t val_count);
+int regmap_bulk_read(struct regmap *map, unsigned int reg, void *val,
+		     size_t val_count);
+int regmap_update_bits(struct regmap *map, unsigned int reg,
+		       unsigned int mask, unsigned int val);
+
+/* firmware */
+struct firmware {
+	size_t			size;
+	const u8		*data;
+};
+
+int request_firmware(const struct firmware **fw, const char *name,
+		     struct device *device);
+void release_firmware(const struct firmware *fw);
+
+/* GPIO and interrupts */
+struct gpio_desc;
+
+enum gpiod_flags {
+	GPIOD_ASIS,
+	GPIOD_IN,
+	GPIOD_OUT_LOW,
+	GPIOD_OUT_HIGH,
+};
+
+struct gpio_desc *devm_gpiod_get_optional(struct device *dev,
+					  const char *con_id,
+					  enum gpiod_flags flags);
+int gpiod_to_irq(const struct gpio_desc *desc);
+int gpiod_is_active_low(const struct gpio_desc *desc);
+
+typedef int irqreturn_t;
+#define IRQ_NONE		0
+#define IRQ_HANDLED		1
+#define IRQF_TRIGGER_RISING	0x00000001
+#define IRQF_TRIGGER_FALLING	0x00000002
+#define IRQF_ONESHOT		0x00002000
+
+typedef irqreturn_t (*irq_handler_t)(int irq, void *dev_id);
+
+int devm_request_threaded_irq(struct device *dev, unsigned int irq,
+			      irq_handler_t handler, irq_handler_t thread_fn,
+			      unsigned long irqflags, const char *devname,
+			      void *dev_id);
+void disable_irq(unsigned int irq);
+void enable_irq(unsigned int irq);
+
+/* hwmon and thermal */
+enum hwmon_sensor_types {
+	hwmon_chip,
+	hwmon_temp,
+};
+
+enum hwmon_temp_attributes {
+	hwmon_temp_enable,
+	hwmon_temp_input,
+};
+
+#define HWMON_T_INPUT	BIT(hwmon_temp_input)
+
+struct hwmon_channel_info {
+	enum hwmon_sensor_types	type;
+	const u32		*config;
+};
+
+#define HWMON_CHANNEL_INFO(stype, ...)					\
+	(&(struct hwmon_channel_info) {					\
+		.type = hwmon_##stype,					\
+		.config = (u32 []) { __VA_ARGS__, 0 }			\
+	})
+
+struct hwmon_ops {
+	umode_t (*is_visible)(const void *drvdata,
+			      enum hwmon_sensor_types type, u32 attr,
+			      int channel);
+	int (*read)(struct device *dev, enum hwmon_sensor_types type,
+		    u32 attr, int channel, long *val);
+};
+
+struct hwmon_chip_info {
+	const struct hwmon_ops	*ops;
+	const struct hwmon_channel_info **info;
+};
+
+struct device *hwmon_device_register_with_info(struct device *dev,
+		const char *name, void *drvdata,
+		const struct hwmon_chip_info *info,
+		const void *extra_groups);
+void hwmon_device_unregister(struct device *dev);
+
+struct thermal_cooling_device;
+
+struct thermal_cooling_device_ops {
+	int (*get_max_state)(struct thermal_cooling_device *cdev,
+			     unsigned long *state);
+	int (*get_cur_state)(struct thermal_cooling_device *cdev,
+			     unsigned long *state);
+	int (*set_cur_state)(struct thermal_cooling_device *cdev,
+			     unsigned long state);
+};
+
+struct thermal_cooling_device {
+	void			*devdata;
+	const struct thermal_cooling_device_ops *ops;
+};
+
+struct thermal_cooling_device *
+thermal_of_cooling_device_register(struct device_node *np,
+		const char *type, void *devdata,
+		const struct thermal_cooling_device_ops *ops);
+void thermal_cooling_device_unregister(struct thermal_cooling_device *cdev);
+
+/* debugfs and seq_file: files are kept in a table the simulator can
+ * read and write through their file_operations
+ */
+struct dentry;
+
+struct inode {
+	void			*i_private;
+};
+
+struct file {
+	void			*private_data;
+};
+
+struct file_operations {
+	struct module		*owner;
+	int (*open)(struct inode *inode, struct file *file);
+	ssize_t (*read)(struct file *file, char __user *buf, size_t count,
+			loff_t *ppos);
+	ssize_t (*write)(struct file *file, const char __user *buf,
+			 size_t count, loff_t *ppos);
+	loff_t (*llseek)(struct file *file, loff_t offset, int whence);
+	int (*release)(struct inode *inode, struct file *file);
+};
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent);
+struct dentry *debugfs_create_file(const char *name, umode_t mode,
+				   struct dentry *parent, void *data,
+				   const struct file_operations *fops);
+
+struct seq_file {
+	char			*buf;
+	size_t			size;
+	size_t			count;
+	void			*private;
+	int (*show)(struct seq_file *m, void *v);
+};
+
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t count,
+		 loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+
+/* ALSA controls */
+#define SNDRV_CTL_ELEM_TYPE_BOOLEAN	1
+#define SNDRV_CTL_ELEM_TYPE_INTEGER	2
+#define SNDRV_CTL_ELEM_TYPE_ENUMERATED	3
+#define SNDRV_CTL_ELEM_TYPE_BYTES	4
+
+#define SNDRV_CTL_ELEM_IFACE_MIXER	2
+
+#define SNDRV_CTL_ELEM_ACCESS_READ	(1 << 0)
+#define SNDRV_CTL_ELEM_ACCESS_WRITE	(1 << 1)
+#define SNDRV_CTL_ELEM_ACCESS_READWRITE	\
+	(SNDRV_CTL_ELEM_ACCESS_READ | SNDRV_CTL_ELEM_ACCESS_WRITE)
+#define SNDRV_CTL_ELEM_ACCESS_VOLATILE	(1 << 2)
+#define SNDRV_CTL_ELEM_ACCESS_TLV_READ	(1 << 4)
+#define SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK	(1 << 28)
+
+#define SNDRV_CTL_TLV_OP_READ		0
+#define SNDRV_CTL_TLVT_DB_SCALE		1
+#define SNDRV_CTL_TLVD_DB_SCALE_MASK	0xffff
+#define SNDRV_CTL_TLVD_DB_SCALE_MUTE	0x10000
+
+struct snd_ctl_elem_info {
+	int			type;
+	unsigned int		access;
+	unsigned int		count;
+	union {
+		struct {
+			long	min;
+			long	max;
+			long	step;
+		} integer;
+		struct {
+			unsigned int	items;
+			unsigned int	item;
+			char		name[64];
+		} enumerated;
+	} value;
+};
+
+struct snd_ctl_elem_value {
+	union {
+		union {
+			long	value[128];
+		} integer;
+		union {
+			unsigned int	item[128];
+		} enumerated;
+		union {
+			unsigned char	data[512];
+		} bytes;
+	} value;
+};
+
+struct snd_kcontrol;
+
+typedef int (snd_kcontrol_info_t)(struct snd_kcontrol *kcontrol,
+				  struct snd_ctl_elem_info *uinfo);
+typedef int (snd_kcontrol_get_t)(struct snd_kcontrol *kcontrol,
+				 struct snd_ctl_elem_value *ucontrol);
+typedef int (snd_kcontrol_put_t)(struct snd_kcontrol *kcontrol,
+				 struct snd_ctl_elem_value *ucontrol);
+typedef int (snd_kcontrol_tlv_rw_t)(struct snd_kcontrol *kcontrol,
+				    int op_flag, unsigned int size,
+				    unsigned int __user *tlv);
+
+struct snd_kcontrol_new {
+	int			iface;
+	const char		*name;
+	unsigned int		index;
+	unsigned int		access;
+	snd_kcontrol_info_t	*info;
+	snd_kcontrol_get_t	*get;
+	snd_kcontrol_put_t	*put;
+	union {
+		snd_kcontrol_tlv_rw_t	*c;
+		const unsigned int	*p;
+	} tlv;
+	unsigned long		private_value;
+};
+
+struct snd_kcontrol {
+	struct list_head	list;
+	struct snd_kcontrol_new	new;
+	unsigned long		private_value;
+	void			*private_data;
+};
+
+int snd_ctl_enum_info(struct snd_ctl_elem_info *info, unsigned int channels,
+		      unsigned int items, const char *const names[]);
+
+/* PCM */
+#define SNDRV_PCM_STREAM_PLAYBACK	0
+#define SNDRV_PCM_STREAM_CAPTURE	1
+
+#define SNDRV_PCM_TRIGGER_STOP		0
+#define SNDRV_PCM_TRIGGER_START		1
+#define SNDRV_PCM_TRIGGER_PAUSE_PUSH	3
+#define SNDRV_PCM_TRIGGER_PAUSE_RELEASE	4
+#define SNDRV_PCM_TRIGGER_SUSPEND	5
+#define SNDRV_PCM_TRIGGER_RESUME	6
+
+#define SNDRV_PCM_RATE_44100		(1 << 6)
+#define SNDRV_PCM_RATE_48000		(1 << 7)
+#define SNDRV_PCM_RATE_96000		(1 << 10)
+#define SNDRV_PCM_FMTBIT_S16_LE		(1ULL << 2)
+#define SNDRV_PCM_FMTBIT_S24_LE		(1ULL << 6)
+#define SNDRV_PCM_FMTBIT_S32_LE		(1ULL << 10)
+
+struct snd_soc_pcm_runtime;
+
+struct snd_pcm_substream {
+	int			stream;
+	void			*private_data;
+};
+
+struct snd_pcm_hw_params;
+
+/* ASoC */
+struct snd_soc_component;
+struct snd_soc_dai;
+
+struct snd_soc_dapm_context {
+	struct snd_soc_component *component;
+};
+
+enum snd_soc_dapm_type {
+	snd_soc_dapm_input,
+	snd_soc_dapm_output,
+	snd_soc_dapm_dac,
+	snd_soc_dapm_aif_in,
+};
+
+#define SND_SOC_NOPM		-1
+
+#define SND_SOC_DAPM_PRE_PMU	0x1
+#define SND_SOC_DAPM_POST_PMU	0x2
+#define SND_SOC_DAPM_PRE_PMD	0x4
+#define SND_SOC_DAPM_POST_PMD	0x8
+
+struct snd_soc_dapm_widget {
+	enum snd_soc_dapm_type	id;
+	const char		*name;
+	const char		*sname;
+	int			reg;
+	unsigned char		shift;
+	unsigned char		invert;
+	int (*event)(struct snd_soc_dapm_widget *w,
+		     struct snd_kcontrol *kcontrol, int event);
+	unsigned short		event_flags;
+	struct snd_soc_dapm_context *dapm;
+};
+
+#define SND_SOC_DAPM_OUTPUT(wname)					\
+{	.id = snd_soc_dapm_output, .name = wname, .sname = NULL,	\
+	.reg = SND_SOC_NOPM }
+#define SND_SOC_DAPM_AIF_IN(wname, stname, wchan, wreg, wshift, winvert) \
+{	.id = snd_soc_dapm_aif_in, .name = wname, .sname = stname,	\
+	.reg = wreg, .shift = wshift, .invert = winvert }
+#define SND_SOC_DAPM_DAC_E(wname, stname, wreg, wshift, winvert,	\
+			   wevent, wflags)				\
+{	.id = snd_soc_dapm_dac, .name = wname, .sname = stname,		\
+	.reg = wreg, .shift = wshift, .invert = winvert,		\
+	.event = wevent, .event_flags = wflags }
+
+struct snd_soc_dapm_route {
+	const char		*sink;
+	const char		*control;
+	const char		*source;
+};
+
+struct snd_soc_component_driver {
+	const char		*name;
+	int (*probe)(struct snd_soc_component *component);
+	void (*remove)(struct snd_soc_component *component);
+	void (*debugfs_init)(struct snd_soc_component *component,
+			     struct dentry *debugfs_root);
+	const struct snd_kcontrol_new *controls;
+	unsigned int		num_controls;
+	const struct snd_soc_dapm_widget *dapm_widgets;
+	unsigned int		num_dapm_widgets;
+	const struct snd_soc_dapm_route *dapm_routes;
+	unsigned int		num_dapm_routes;
+	unsigned int		idle_bias_on:1;
+	unsigned int		use_pmdown_time:1;
+	unsigned int		endianness:1;
+};
+
+struct snd_soc_component {
+	const char		*name;
+	struct device		*dev;
+	const struct snd_soc_component_driver *driver;
+	struct snd_soc_dapm_context dapm;
+	struct list_head	controls;
+	struct list_head	list;
+};
+
+#define SND_SOC_DAIFMT_I2S		1
+#define SND_SOC_DAIFMT_RIGHT_J		2
+#define SND_SOC_DAIFMT_LEFT_J		3
+#define SND_SOC_DAIFMT_DSP_A		4
+#define SND_SOC_DAIFMT_DSP_B		5
+#define SND_SOC_DAIFMT_AC97		6
+#define SND_SOC_DAIFMT_PDM		7
+
+#define SND_SOC_DAIFMT_NB_NF		(0 << 8)
+#define SND_SOC_DAIFMT_NB_IF		(2 << 8)
+#define SND_SOC_DAIFMT_IB_NF		(3 << 8)
+#define SND_SOC_DAIFMT_IB_IF		(4 << 8)
+
+#define SND_SOC_DAIFMT_CBP_CFP		(1 << 12)
+#define SND_SOC_DAIFMT_CBC_CFP		(2 << 12)
+#define SND_SOC_DAIFMT_CBP_CFC		(3 << 12)
+#define SND_SOC_DAIFMT_CBC_CFC		(4 << 12)
+
+#define SND_SOC_DAIFMT_FORMAT_MASK		0x000f
+#define SND_SOC_DAIFMT_CLOCK_MASK		0x00f0
+#define SND_SOC_DAIFMT_INV_MASK			0x0f00
+#define SND_SOC_DAIFMT_CLOCK_PROVIDER_MASK	0xf000
+
+struct snd_soc_dai_ops {
+	int (*set_fmt)(struct snd_soc_dai *dai, unsigned int fmt);
+	int (*startup)(struct snd_pcm_substream *substream,
+		       struct snd_soc_dai *dai);
+	void (*shutdown)(struct snd_pcm_substream *substream,
+			 struct snd_soc_dai *dai);
+	int (*hw_params)(struct snd_pcm_substream *substream,
+			 struct snd_pcm_hw_params *params,
+			 struct snd_soc_dai *dai);
+	int (*hw_free)(struct snd_pcm_substream *substream,
+		       struct snd_soc_dai *dai);
+	int (*prepare)(struct snd_pcm_substream *substream,
+		       struct snd_soc_dai *dai);
+	int (*trigger)(struct snd_pcm_substream *substream, int cmd,
+		       struct snd_soc_dai *dai);
+	int (*mute_stream)(struct snd_soc_dai *dai, int mute, int stream);
+	unsigned int		no_capture_mute:1;
+};
+
+struct snd_soc_pcm_stream {
+	const char		*stream_name;
+	u64			formats;
+	unsigned int		rates;
+	unsigned int		channels_min;
+	unsigned int		channels_max;
+};
+
+struct snd_soc_dai_driver {
+	const char		*name;
+	unsigned int		id;
+	struct snd_soc_pcm_stream playback;
+	struct snd_soc_pcm_stream capture;
+	const struct snd_soc_dai_ops *ops;
+};
+
+struct snd_soc_dai {
+	const char		*name;
+	struct device		*dev;
+	struct snd_soc_dai_driver *driver;
+	struct snd_soc_component *component;
+};
+
+struct snd_soc_pcm_runtime {
+	unsigned int		num_codecs;
+	struct snd_soc_dai	**codec_dais;
+};
+
+static inline struct snd_soc_pcm_runtime *
+asoc_substream_to_rtd(const struct snd_pcm_substream *substream)
+{
+	return substream->private_data;
+}
+
+#define asoc_rtd_to_codec(rtd, n)	((rtd)->codec_dais[n])
+#define for_each_rtd_codec_dais(rtd, i, dai)				\
+	for ((i) = 0;							\
+	     ((i) < (rtd)->num_codecs) &&				\
+		     ((dai) = asoc_rtd_to_codec(rtd, i));		\
+	     (i)++)
+
+static inline void *
+snd_soc_component_get_drvdata(struct snd_soc_component *c)
+{
+	return dev_get_drvdata(c->dev);
+}
+
+static inline struct snd_soc_component *
+snd_soc_kcontrol_component(struct snd_kcontrol *kcontrol)
+{
+	return kcontrol->private_data;
+}
+
+static inline struct snd_soc_component *
+snd_soc_dapm_to_component(struct snd_soc_dapm_context *dapm)
+{
+	return dapm->component;
+}
+
+int snd_soc_register_component(struct device *dev,
+			const struct snd_soc_component_driver *component_driver,
+			struct snd_soc_dai_driver *dai_drv, int num_dai);
+void snd_soc_unregister_component(struct device *dev);
+int snd_soc_add_component_controls(struct snd_soc_component *component,
+				   const struct snd_kcontrol_new *controls,
+				   unsigned int num_controls);
+int snd_soc_component_notify_control(struct snd_soc_component *component,
+				     const char * const ctl);
+
+#endif
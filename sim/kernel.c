@@ -0,0 +1,1383 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Kernel services for the simulator: a virtual clock, a single
+// threaded work queue, memory, properties, firmware and logging.
+//
+
+#include <stdarg.h>
+#include <sys/stat.h>
+
+#include "sim.h"
+
+struct module {
+	const char		*name;
+} __this_module = { "acmsim" };
+
+int sim_verbose;
+ktime_t sim_now;
+const char *sim_fw_dir;
+struct sim_gpio_cfg sim_gpio;
+
+/* There is one worker; every queue is the same queue */
+static char sim_wq;
+struct workqueue_struct *system_wq = (struct workqueue_struct *)&sim_wq;
+struct workqueue_struct *system_unbound_wq = (struct workqueue_struct *)&sim_wq;
+struct workqueue_struct *system_power_efficient_wq =
+	(struct workqueue_struct *)&sim_wq;
+
+/* printk, with the %*ph hex dump extension */
+static void sim_vformat(char *buf, size_t size, const char *fmt, va_list ap)
+{
+	char spec[32], *s;
+	size_t n = 0;
+	int len;
+
+#define PUT(...)							\
+	do {								\
+		len = snprintf(buf + n, size - n, __VA_ARGS__);		\
+		n = min_t(size_t, n + max(len, 0), size - 1);		\
+	} while (0)
+
+	while (*fmt && n < size - 1) {
+		int star = -1, lmod = 0;
+
+		if (*fmt != '%') {
+			buf[n++] = *fmt++;
+			continue;
+		}
+
+		s = spec;
+		*s++ = *fmt++;
+		if (*fmt == '%') {
+			buf[n++] = *fmt++;
+			continue;
+		}
+
+		while (*fmt && strchr("-+ #0", *fmt))
+			*s++ = *fmt++;
+		if (*fmt == '*') {
+			star = va_arg(ap, int);
+			s += sprintf(s, "%d", star);
+			fmt++;
+		}
+		while (*fmt >= '0' && *fmt <= '9')
+			*s++ = *fmt++;
+		if (*fmt == '.') {
+			*s++ = *fmt++;
+			if (*fmt == '*') {
+				s += sprintf(s, "%d", va_arg(ap, int));
+				fmt++;
+			}
+			while (*fmt >= '0' && *fmt <= '9')
+				*s++ = *fmt++;
+		}
+		while (*fmt && strchr("hlzjt", *fmt)) {
+			lmod += *fmt == 'l' ? 1 : 0;
+			if (*fmt == 'z' || *fmt == 'j' || *fmt == 't')
+				lmod = 2;
+			*s++ = *fmt++;
+		}
+		*s++ = *fmt;
+		*s = '\0';
+
+		switch (*fmt) {
+		case 'd':
+		case 'i':
+			if (lmod >= 2)
+				PUT(spec, va_arg(ap, long long));
+			else if (lmod)
+				PUT(spec, va_arg(ap, long));
+			else
+				PUT(spec, va_arg(ap, int));
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			if (lmod >= 2)
+				PUT(spec, va_arg(ap, unsigned long long));
+			else if (lmod)
+				PUT(spec, va_arg(ap, unsigned long));
+			else
+				PUT(spec, va_arg(ap, unsigned int));
+			break;
+		case 'c':
+			PUT(spec, va_arg(ap, int));
+			break;
+		case 's':
+			PUT(spec, va_arg(ap, const char *));
+			break;
+		case 'p':
+			if (fmt[1] == 'h') {
+				const u8 *p = va_arg(ap, const u8 *);
+				int i;
+
+				for (i = 0; i < (star < 0 ? 1 : star); i++)
+					PUT(i ? " %02x" : "%02x", p[i]);
+				fmt++;
+			} else {
+				PUT("%p", va_arg(ap, void *));
+			}
+			break;
+		default:
+			PUT("%s", spec);
+			break;
+		}
+		if (*fmt)
+			fmt++;
+	}
+	buf[n] = '\0';
+#undef PUT
+}
+
+void sim_dev_printk(const char *level, const struct device *dev,
+		    const char *fmt, ...)
+{
+	char buf[512];
+	va_list ap;
+	int lvl = level[0] - '0';
+	FILE *f = lvl <= 4 ? stderr : stdout;
+
+	if ((lvl == 6 && sim_verbose < 1) || (lvl == 7 && sim_verbose < 2))
+		return;
+
+	va_start(ap, fmt);
+	sim_vformat(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	fprintf(f, "[%10.3f] %s%s%s", ktime_to_us(sim_now) / 1000.0,
+		dev ? dev_name(dev) : "", dev ? ": " : "", buf);
+	if (!*buf || buf[strlen(buf) - 1] != '\n')
+		fputc('\n', f);
+}
+
+/* library */
+void *memchr_inv(const void *s, int c, size_t n)
+{
+	const u8 *p = s;
+
+	for (; n; n--, p++)
+		if (*p != (u8)c)
+			return (void *)p;
+
+	return NULL;
+}
+
+size_t strscpy(char *dest, const char *src, size_t count)
+{
+	size_t len = strnlen(src, count);
+
+	if (!count)
+		return -E2BIG;
+	if (len == count) {
+		memcpy(dest, src, count - 1);
+		dest[count - 1] = '\0';
+		return -E2BIG;
+	}
+	memcpy(dest, src, len + 1);
+
+	return len;
+}
+
+/* The drivers never pass a swap function */
+void sort(void *base, size_t num, size_t size, cmp_func_t cmp_func,
+	  swap_func_t swap_func)
+{
+	if (swap_func)
+		abort();
+
+	qsort(base, num, size, cmp_func);
+}
+
+void bitmap_zero(unsigned long *dst, unsigned int nbits)
+{
+	memset(dst, 0, BITS_TO_LONGS(nbits) * sizeof(unsigned long));
+}
+
+void bitmap_fill(unsigned long *dst, unsigned int nbits)
+{
+	unsigned int i;
+
+	bitmap_zero(dst, nbits);
+	for (i = 0; i < nbits; i++)
+		__set_bit(i, dst);
+}
+
+void bitmap_set(unsigned long *map, unsigned int start, unsigned int nbits)
+{
+	while (nbits--)
+		__set_bit(start++, map);
+}
+
+void bitmap_clear(unsigned long *map, unsigned int start, unsigned int nbits)
+{
+	while (nbits--)
+		__clear_bit(start++, map);
+}
+
+void bitmap_or(unsigned long *dst, const unsigned long *src1,
+	       const unsigned long *src2, unsigned int nbits)
+{
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(nbits); i++)
+		dst[i] = src1[i] | src2[i];
+}
+
+unsigned int bitmap_weight(const unsigned long *src, unsigned int nbits)
+{
+	unsigned int i, w = 0;
+
+	for (i = 0; i < nbits; i++)
+		w += test_bit(i, src);
+
+	return w;
+}
+
+bool bitmap_subset(const unsigned long *src1, const unsigned long *src2,
+		   unsigned int nbits)
+{
+	unsigned int i;
+
+	for (i = 0; i < nbits; i++)
+		if (test_bit(i, src1) && !test_bit(i, src2))
+			return false;
+
+	return true;
+}
+
+unsigned long find_next_bit(const unsigned long *addr, unsigned long size,
+			    unsigned long offset)
+{
+	for (; offset < size; offset++)
+		if (test_bit(offset, addr))
+			return offset;
+
+	return size;
+}
+
+unsigned long find_next_zero_bit(const unsigned long *addr,
+				 unsigned long size, unsigned long offset)
+{
+	for (; offset < size; offset++)
+		if (!test_bit(offset, addr))
+			return offset;
+
+	return size;
+}
+
+unsigned long find_last_bit(const unsigned long *addr, unsigned long size)
+{
+	unsigned long i;
+
+	for (i = size; i; i--)
+		if (test_bit(i - 1, addr))
+			return i - 1;
+
+	return size;
+}
+
+#define XXH_PRIME32_1	2654435761U
+#define XXH_PRIME32_2	2246822519U
+#define XXH_PRIME32_3	3266489917U
+#define XXH_PRIME32_4	668265263U
+#define XXH_PRIME32_5	374761393U
+
+static u32 xxh32_rotl(u32 x, int r)
+{
+	return x << r | x >> (32 - r);
+}
+
+static u32 xxh32_round(u32 acc, u32 input)
+{
+	return xxh32_rotl(acc + input * XXH_PRIME32_2, 13) * XXH_PRIME32_1;
+}
+
+u32 xxh32(const void *input, size_t len, u32 seed)
+{
+	const u8 *p = input, *end = p + len;
+	u32 v[4], h;
+	int i;
+
+	if (len >= 16) {
+		v[0] = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+		v[1] = seed + XXH_PRIME32_2;
+		v[2] = seed;
+		v[3] = seed - XXH_PRIME32_1;
+		do {
+			for (i = 0; i < 4; i++, p += 4)
+				v[i] = xxh32_round(v[i], get_unaligned_le32(p));
+		} while (p <= end - 16);
+		h = xxh32_rotl(v[0], 1) + xxh32_rotl(v[1], 7) +
+		    xxh32_rotl(v[2], 12) + xxh32_rotl(v[3], 18);
+	} else {
+		h = seed + XXH_PRIME32_5;
+	}
+
+	h += len;
+	for (; p + 4 <= end; p += 4)
+		h = xxh32_rotl(h + get_unaligned_le32(p) * XXH_PRIME32_3, 17) *
+		    XXH_PRIME32_4;
+	for (; p < end; p++)
+		h = xxh32_rotl(h + *p * XXH_PRIME32_5, 11) * XXH_PRIME32_1;
+
+	h ^= h >> 15;
+	h *= XXH_PRIME32_2;
+	h ^= h >> 13;
+	h *= XXH_PRIME32_3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/* Decompression */
+static int sim_lz4_len(const u8 **ip, const u8 *end, size_t *len)
+{
+	u8 b;
+
+	if (*len != 15)
+		return 0;
+
+	do {
+		if (*ip >= end)
+			return -1;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+
+	return 0;
+}
+
+int LZ4_decompress_safe_usingDict(const char *source, char *dest,
+				  int compressed_size, int max_output_size,
+				  const char *dict_start, int dict_size)
+{
+	const u8 *ip = (const u8 *)source, *end = ip + compressed_size;
+	u8 *op = (u8 *)dest, *oend = op + max_output_size;
+	const u8 *low = op - dict_size;
+	size_t lit, len, off;
+
+	if (dict_size && dict_start + dict_size != dest)
+		return -1;
+
+	while (ip < end) {
+		lit = *ip >> 4;
+		len = *ip++ & 15;
+
+		if (sim_lz4_len(&ip, end, &lit) ||
+		    lit > (size_t)(end - ip) || lit > (size_t)(oend - op))
+			return -1;
+		memcpy(op, ip, lit);
+		op += lit;
+		ip += lit;
+
+		/* The last sequence has literals only */
+		if (ip == end)
+			break;
+
+		if (end - ip < 2)
+			return -1;
+		off = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (!off || off > (size_t)(op - low) ||
+		    sim_lz4_len(&ip, end, &len))
+			return -1;
+
+		len += 4;
+		if (len > (size_t)(oend - op))
+			return -1;
+		for (; len; len--, op++)
+			*op = op[-off];
+	}
+
+	return op - (u8 *)dest;
+}
+
+int LZ4_decompress_safe(const char *source, char *dest, int compressed_size,
+			int max_decompressed_size)
+{
+	return LZ4_decompress_safe_usingDict(source, dest, compressed_size,
+					     max_decompressed_size, NULL, 0);
+}
+
+size_t zstd_get_frame_header(zstd_frame_header *params, const void *src,
+			     size_t src_size)
+{
+	return -1;
+}
+
+size_t zstd_dctx_workspace_bound(void)
+{
+	return 1;
+}
+
+zstd_dctx *zstd_init_dctx(void *workspace, size_t workspace_size)
+{
+	return NULL;
+}
+
+size_t zstd_decompress_dctx(zstd_dctx *dctx, void *dst, size_t dst_capacity,
+			    const void *src, size_t src_size)
+{
+	return -1;
+}
+
+unsigned int zstd_is_error(size_t code)
+{
+	return code > (size_t)-120;
+}
+
+static u32 sim_rand_state = 0x2545f491;
+
+void sim_seed(u32 seed)
+{
+	sim_rand_state = seed ?: 1;
+}
+
+u32 get_random_u32(void)
+{
+	u32 x = sim_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	sim_rand_state = x;
+
+	return x;
+}
+
+/* module parameters */
+extern const struct sim_param __start_sim_params[] __attribute__((weak));
+extern const struct sim_param __stop_sim_params[] __attribute__((weak));
+
+int sim_set_param(const char *arg)
+{
+	const struct sim_param *p;
+	const char *eq = strchr(arg, '=');
+	size_t len = eq ? (size_t)(eq - arg) : strlen(arg);
+	const char *val = eq ? eq + 1 : "1";
+
+	for (p = __start_sim_params; p && p < __stop_sim_params; p++) {
+		if (strlen(p->name) != len || strncmp(p->name, arg, len))
+			continue;
+
+		switch (p->type) {
+		case SIM_PARAM_int:
+			*(int *)p->value = strtol(val, NULL, 0);
+			break;
+		case SIM_PARAM_uint:
+			*(unsigned int *)p->value = strtoul(val, NULL, 0);
+			break;
+		case SIM_PARAM_bool:
+			*(bool *)p->value = strchr("yY1", *val) != NULL;
+			break;
+		}
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+void sim_list_params(FILE *f)
+{
+	static const char *const types[] = {
+		[SIM_PARAM_int]		= "int",
+		[SIM_PARAM_uint]	= "uint",
+		[SIM_PARAM_bool]	= "bool",
+	};
+	const struct sim_param *p = __start_sim_params;
+
+	if (!p || p == __stop_sim_params)
+		return;
+
+	fprintf(f, "\nmodule parameters:\n");
+	for (; p < __stop_sim_params; p++)
+		fprintf(f, "  %-24s %s\n", p->name, types[p->type]);
+}
+
+/* memory */
+void *kmalloc(size_t size, gfp_t flags)
+{
+	return malloc(size ?: 1);
+}
+
+void *kzalloc(size_t size, gfp_t flags)
+{
+	return calloc(1, size ?: 1);
+}
+
+void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	return calloc(n ?: 1, size ?: 1);
+}
+
+void *kmemdup(const void *src, size_t len, gfp_t flags)
+{
+	void *p = kmalloc(len, flags);
+
+	if (p)
+		memcpy(p, src, len);
+
+	return p;
+}
+
+void kfree(const void *ptr)
+{
+	free((void *)ptr);
+}
+
+struct sim_devres {
+	struct list_head	node;
+	size_t			size;
+} __attribute__((aligned(16)));
+
+static struct list_head *sim_devres_list(struct device *dev)
+{
+	if (!dev->devres.next)
+		INIT_LIST_HEAD(&dev->devres);
+
+	return &dev->devres;
+}
+
+void *devm_kmalloc(struct device *dev, size_t size, gfp_t gfp)
+{
+	struct sim_devres *dr = calloc(1, sizeof(*dr) + size);
+
+	if (!dr)
+		return NULL;
+
+	dr->size = size;
+	list_add_tail(&dr->node, sim_devres_list(dev));
+
+	return dr + 1;
+}
+
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp)
+{
+	return devm_kmalloc(dev, size, gfp);
+}
+
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t gfp)
+{
+	return devm_kmalloc(dev, n * size, gfp);
+}
+
+void *devm_kmemdup(struct device *dev, const void *src, size_t len,
+		   gfp_t gfp)
+{
+	void *p = devm_kmalloc(dev, len, gfp);
+
+	if (p)
+		memcpy(p, src, len);
+
+	return p;
+}
+
+void devm_kfree(struct device *dev, const void *p)
+{
+	struct sim_devres *dr = (struct sim_devres *)p - 1;
+
+	if (!p)
+		return;
+
+	list_del(&dr->node);
+	free(dr);
+}
+
+void sim_devres_release(struct device *dev)
+{
+	struct sim_devres *dr, *tmp;
+
+	list_for_each_entry_safe(dr, tmp, sim_devres_list(dev), node) {
+		list_del(&dr->node);
+		free(dr);
+	}
+}
+
+/* properties */
+static const struct sim_prop *sim_prop_find(struct device *dev,
+					    const char *name)
+{
+	const struct sim_prop *p;
+
+	for (p = dev->props; p && p->name; p++)
+		if (!strcmp(p->name, name))
+			return p;
+
+	return NULL;
+}
+
+bool device_property_present(struct device *dev, const char *propname)
+{
+	return sim_prop_find(dev, propname);
+}
+
+int device_property_read_u32(struct device *dev, const char *propname,
+			     u32 *val)
+{
+	const struct sim_prop *p = sim_prop_find(dev, propname);
+
+	if (!p)
+		return -EINVAL;
+	if (p->str)
+		return -EPROTO;
+
+	*val = p->val;
+	return 0;
+}
+
+int device_property_read_string(struct device *dev, const char *propname,
+				const char **val)
+{
+	const struct sim_prop *p = sim_prop_find(dev, propname);
+
+	if (!p)
+		return -EINVAL;
+	if (p->strv)
+		*val = p->strv[0];
+	else if (p->str)
+		*val = p->str;
+	else
+		return -EPROTO;
+
+	return 0;
+}
+
+int device_property_read_string_array(struct device *dev,
+				      const char *propname, const char **val,
+				      size_t nval)
+{
+	const struct sim_prop *p = sim_prop_find(dev, propname);
+	size_t n;
+
+	if (!p)
+		return -EINVAL;
+	if (!p->strv) {
+		if (!p->str)
+			return -EPROTO;
+		if (val && nval)
+			val[0] = p->str;
+		return 1;
+	}
+
+	for (n = 0; p->strv[n]; n++)
+		if (val && n < nval)
+			val[n] = p->strv[n];
+
+	return val ? min(n, nval) : n;
+}
+
+/* sysfs */
+int sim_dev_attr_store(struct device *dev, const char *name,
+		       const char *buf)
+{
+	const struct attribute_group **grp;
+	struct device_attribute *attr;
+	struct attribute **a;
+	ssize_t ret;
+
+	for (grp = sim_i2c_driver->driver.dev_groups; grp && *grp; grp++) {
+		for (a = (*grp)->attrs; *a; a++) {
+			if (strcmp((*a)->name, name))
+				continue;
+
+			attr = container_of(*a, struct device_attribute, attr);
+			if (!attr->store)
+				return -EACCES;
+
+			ret = attr->store(dev, attr, buf, strlen(buf));
+			return ret < 0 ? ret : 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/* debugfs: a flat table of directories and files */
+struct dentry {
+	char			name[16];
+	struct dentry		*parent;
+	void			*data;
+	const struct file_operations *fops;	/* NULL for a directory */
+};
+
+#define SIM_MAX_DENTRIES	64
+
+static struct dentry sim_dentries[SIM_MAX_DENTRIES];
+static int sim_num_dentries;
+
+struct dentry *debugfs_create_file(const char *name, umode_t mode,
+				   struct dentry *parent, void *data,
+				   const struct file_operations *fops)
+{
+	struct dentry *d;
+
+	if (IS_ERR(parent) || sim_num_dentries == SIM_MAX_DENTRIES)
+		return ERR_PTR(-ENOMEM);
+
+	d = &sim_dentries[sim_num_dentries++];
+	strscpy(d->name, name, sizeof(d->name));
+	d->parent = parent;
+	d->data = data;
+	d->fops = fops;
+
+	return d;
+}
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+	return debugfs_create_file(name, 0, parent, NULL, NULL);
+}
+
+struct dentry *sim_debugfs_next(struct dentry *d)
+{
+	d = d ? d + 1 : sim_dentries;
+	for (; d < sim_dentries + sim_num_dentries; d++)
+		if (d->fops)
+			return d;
+
+	return NULL;
+}
+
+/* Built from the file name outwards, one parent at a time */
+void sim_debugfs_path(const struct dentry *d, char *buf, size_t size)
+{
+	const struct dentry *p;
+	size_t len = 0, n;
+
+	buf[0] = '\0';
+	for (p = d; p; p = p->parent) {
+		n = strlen(p->name) + (p != d);
+		if (len + n >= size)
+			break;
+
+		memmove(buf + n, buf, len + 1);
+		memcpy(buf, p->name, n - (p != d));
+		if (p != d)
+			buf[n - 1] = '/';
+		len += n;
+	}
+}
+
+/* Open, read or write in one go, and release, as a shell would */
+int sim_debugfs_read(struct dentry *d, char *buf, size_t size)
+{
+	struct inode inode = { .i_private = d->data };
+	struct file file = { NULL };
+	loff_t pos = 0;
+	ssize_t n = 0, len;
+	int ret;
+
+	ret = d->fops->open ? d->fops->open(&inode, &file) : 0;
+	if (ret)
+		return ret;
+
+	while ((len = d->fops->read(&file, buf + n, size - 1 - n, &pos)) > 0)
+		n += len;
+	buf[n] = '\0';
+
+	if (d->fops->release)
+		d->fops->release(&inode, &file);
+
+	return len < 0 ? len : 0;
+}
+
+int sim_debugfs_write(struct dentry *d, const char *buf)
+{
+	struct inode inode = { .i_private = d->data };
+	struct file file = { NULL };
+	loff_t pos = 0;
+	ssize_t len;
+	int ret;
+
+	if (!d->fops->write)
+		return -EACCES;
+
+	ret = d->fops->open ? d->fops->open(&inode, &file) : 0;
+	if (ret)
+		return ret;
+
+	len = d->fops->write(&file, buf, strlen(buf), &pos);
+
+	if (d->fops->release)
+		d->fops->release(&inode, &file);
+
+	return len < 0 ? len : 0;
+}
+
+/* seq_file: show() fills the whole buffer on the first read */
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	char buf[512];
+	size_t len;
+	va_list ap;
+
+	va_start(ap, fmt);
+	sim_vformat(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	len = strlen(buf);
+	if (m->count + len + 1 > m->size) {
+		m->size = max(2 * m->size, m->count + len + 1);
+		m->buf = realloc(m->buf, m->size);
+		if (!m->buf)
+			abort();
+	}
+	memcpy(m->buf + m->count, buf, len + 1);
+	m->count += len;
+}
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data)
+{
+	struct seq_file *m = calloc(1, sizeof(*m));
+
+	if (!m)
+		return -ENOMEM;
+
+	m->show = show;
+	m->private = data;
+	file->private_data = m;
+
+	return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	free(m->buf);
+	free(m);
+
+	return 0;
+}
+
+ssize_t seq_read(struct file *file, char __user *buf, size_t count,
+		 loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	int ret;
+
+	if (!*ppos) {
+		m->count = 0;
+		ret = m->show(m, NULL);
+		if (ret)
+			return ret;
+	}
+
+	if (*ppos >= m->count)
+		return 0;
+
+	count = min_t(size_t, count, m->count - *ppos);
+	memcpy(buf, m->buf + *ppos, count);
+	*ppos += count;
+
+	return count;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence)
+{
+	return -ESPIPE;
+}
+
+/* firmware, built in with sim_fw_add() or read from --fw-dir */
+#define SIM_MAX_FW	4
+
+static struct {
+	const char	*name;
+	const void	*data;
+	size_t		size;
+} sim_fw[SIM_MAX_FW];
+static int sim_num_fw;
+
+int sim_fw_add(const char *name, const void *data, size_t size)
+{
+	if (sim_num_fw == SIM_MAX_FW)
+		return -ENOSPC;
+
+	sim_fw[sim_num_fw].name = name;
+	sim_fw[sim_num_fw].data = data;
+	sim_fw[sim_num_fw].size = size;
+	sim_num_fw++;
+
+	return 0;
+}
+
+static int sim_fw_get(const struct firmware **fw, const char *name,
+		      struct device *device)
+{
+	struct firmware *f;
+	int i;
+
+	for (i = 0; i < sim_num_fw; i++) {
+		if (strcmp(sim_fw[i].name, name))
+			continue;
+
+		f = calloc(1, sizeof(*f));
+		if (f)
+			f->data = malloc(sim_fw[i].size ?: 1);
+		if (!f || !f->data) {
+			free(f);
+			return -ENOMEM;
+		}
+
+		memcpy((void *)f->data, sim_fw[i].data, sim_fw[i].size);
+		f->size = sim_fw[i].size;
+		*fw = f;
+		dev_dbg(device, "loaded firmware %s (%zu bytes)\n", name,
+			f->size);
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+int request_firmware(const struct firmware **fw, const char *name,
+		     struct device *device)
+{
+	struct firmware *f;
+	char path[512];
+	struct stat st;
+	FILE *file;
+	u8 *data;
+	int ret;
+
+	*fw = NULL;
+	ret = sim_fw_get(fw, name, device);
+	if (ret != -ENOENT)
+		return ret;
+	if (!sim_fw_dir)
+		return -ENOENT;
+
+	snprintf(path, sizeof(path), "%s/%s", sim_fw_dir, name);
+	file = fopen(path, "rb");
+	if (!file || fstat(fileno(file), &st)) {
+		if (file)
+			fclose(file);
+		dev_dbg(device, "firmware %s not found\n", path);
+		return -ENOENT;
+	}
+
+	f = calloc(1, sizeof(*f));
+	data = malloc(st.st_size ?: 1);
+	if (!f || !data || fread(data, 1, st.st_size, file) !=
+			   (size_t)st.st_size) {
+		fclose(file);
+		free(data);
+		free(f);
+		return -EIO;
+	}
+	fclose(file);
+
+	f->data = data;
+	f->size = st.st_size;
+	*fw = f;
+	dev_dbg(device, "loaded firmware %s (%zu bytes)\n", path, f->size);
+
+	return 0;
+}
+
+void release_firmware(const struct firmware *fw)
+{
+	if (!fw)
+		return;
+
+	free((void *)fw->data);
+	free((void *)fw);
+}
+
+/* locking */
+void mutex_init(struct mutex *lock)
+{
+	lock->held = false;
+}
+
+void mutex_lock(struct mutex *lock)
+{
+	/* Whoever holds it is further down our own stack and will not
+	 * run again until we return.
+	 */
+	if (lock->held) {
+		fprintf(stderr, "sim: deadlock: mutex %p already held\n",
+			(void *)lock);
+		abort();
+	}
+	lock->held = true;
+}
+
+void mutex_unlock(struct mutex *lock)
+{
+	if (!lock->held) {
+		fprintf(stderr, "sim: unlocking mutex %p that is not held\n",
+			(void *)lock);
+		abort();
+	}
+	lock->held = false;
+}
+
+/* time */
+ktime_t ktime_get(void)
+{
+	return sim_now;
+}
+
+void sim_sleep_ns(s64 ns)
+{
+	sim_now += ns;
+}
+
+/* Sleeps take their minimum; the scheduler is never late */
+void usleep_range(unsigned long min, unsigned long max)
+{
+	sim_sleep_ns((s64)min * NSEC_PER_USEC);
+}
+
+void msleep(unsigned int msecs)
+{
+	sim_sleep_ns((s64)msecs * NSEC_PER_MSEC);
+}
+
+void udelay(unsigned long usecs)
+{
+	sim_sleep_ns((s64)usecs * NSEC_PER_USEC);
+}
+
+/* timers, kept sorted by expiry */
+static LIST_HEAD(sim_timers);
+
+void sim_timer_add(struct sim_timer *timer, ktime_t expires)
+{
+	struct sim_timer *t;
+
+	sim_timer_del(timer);
+	timer->expires = expires;
+	timer->pending = true;
+
+	list_for_each_entry(t, &sim_timers, node) {
+		if (t->expires > expires) {
+			list_add_tail(&timer->node, &t->node);
+			return;
+		}
+	}
+	list_add_tail(&timer->node, &sim_timers);
+}
+
+void sim_timer_del(struct sim_timer *timer)
+{
+	if (!timer->pending)
+		return;
+
+	list_del(&timer->node);
+	timer->pending = false;
+}
+
+/* work queue: a single worker, first in first out */
+static LIST_HEAD(sim_works);
+
+void INIT_WORK(struct work_struct *work, work_func_t func)
+{
+	memset(work, 0, sizeof(*work));
+	INIT_LIST_HEAD(&work->entry);
+	work->func = func;
+}
+
+static void sim_delayed_work_timer(struct sim_timer *timer)
+{
+	struct delayed_work *dwork =
+		container_of(timer, struct delayed_work, timer);
+
+	queue_work(system_wq, &dwork->work);
+}
+
+void INIT_DELAYED_WORK(struct delayed_work *dwork, work_func_t func)
+{
+	INIT_WORK(&dwork->work, func);
+	dwork->work.delayed = true;
+	memset(&dwork->timer, 0, sizeof(dwork->timer));
+	dwork->timer.fn = sim_delayed_work_timer;
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	if (work->pending)
+		return false;
+
+	work->pending = true;
+	list_add_tail(&work->entry, &sim_works);
+
+	return true;
+}
+
+static bool sim_work_dequeue(struct work_struct *work)
+{
+	if (!work->pending)
+		return false;
+
+	list_del_init(&work->entry);
+	work->pending = false;
+
+	return true;
+}
+
+static void sim_work_wait(struct work_struct *work)
+{
+	/* The only way to get here is from code the work item itself
+	 * is waiting on; the kernel would deadlock just the same.
+	 */
+	if (work->running) {
+		fprintf(stderr, "sim: cancelling work %p from within itself\n",
+			(void *)work);
+		abort();
+	}
+}
+
+bool cancel_work_sync(struct work_struct *work)
+{
+	bool ret = sim_work_dequeue(work);
+
+	sim_work_wait(work);
+
+	return ret;
+}
+
+bool flush_work(struct work_struct *work)
+{
+	bool ret = sim_work_dequeue(work);
+
+	sim_work_wait(work);
+	if (ret) {
+		work->running = true;
+		work->func(work);
+		work->running = false;
+	}
+
+	return ret;
+}
+
+bool queue_delayed_work(struct workqueue_struct *wq,
+			struct delayed_work *dwork, unsigned long delay)
+{
+	if (dwork->work.pending || dwork->timer.pending)
+		return false;
+
+	if (!delay)
+		return queue_work(wq, &dwork->work);
+
+	sim_timer_add(&dwork->timer, sim_now + (s64)delay * NSEC_PER_MSEC);
+
+	return true;
+}
+
+bool mod_delayed_work(struct workqueue_struct *wq,
+		      struct delayed_work *dwork, unsigned long delay)
+{
+	bool ret = dwork->timer.pending;
+
+	sim_timer_del(&dwork->timer);
+	ret |= sim_work_dequeue(&dwork->work);
+	queue_delayed_work(wq, dwork, delay);
+
+	return ret;
+}
+
+bool cancel_delayed_work(struct delayed_work *dwork)
+{
+	bool ret = dwork->timer.pending;
+
+	sim_timer_del(&dwork->timer);
+	ret |= sim_work_dequeue(&dwork->work);
+
+	return ret;
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+	bool ret = cancel_delayed_work(dwork);
+
+	sim_work_wait(&dwork->work);
+
+	return ret;
+}
+
+/* Run the oldest queued work item. When nested inside a waiting work
+ * item only plain work runs: delayed work is periodic housekeeping
+ * that would, in the kernel, simply wait for the sleeper's locks.
+ */
+static bool sim_run_one(bool nested)
+{
+	struct work_struct *work;
+
+	list_for_each_entry(work, &sim_works, entry) {
+		if (work->running || (nested && work->delayed))
+			continue;
+
+		sim_work_dequeue(work);
+		work->running = true;
+		work->func(work);
+		work->running = false;
+
+		return true;
+	}
+
+	return false;
+}
+
+bool sim_wait_step(void)
+{
+	return sim_run_one(true);
+}
+
+static bool sim_fire_timer(ktime_t until)
+{
+	struct sim_timer *t;
+
+	if (list_empty(&sim_timers))
+		return false;
+
+	t = list_first_entry(&sim_timers, struct sim_timer, node);
+	if (t->expires > until)
+		return false;
+
+	if (t->expires > sim_now)
+		sim_now = t->expires;
+	sim_timer_del(t);
+	t->fn(t);
+
+	return true;
+}
+
+void sim_run(void)
+{
+	while (sim_run_one(false) || sim_fire_timer(sim_now))
+		;
+}
+
+void sim_advance_ms(unsigned int ms)
+{
+	ktime_t until = sim_now + (s64)ms * NSEC_PER_MSEC;
+
+	do
+		sim_run();
+	while (sim_fire_timer(until));
+
+	if (sim_now < until)
+		sim_now = until;
+}
+
+/* GPIO and interrupts: the FAULT pin is optional and only wired up
+ * when asked for. Its interrupt number is the amplifier's.
+ */
+struct gpio_desc {
+	unsigned int		irq;
+};
+
+struct sim_irq {
+	irq_handler_t		thread_fn;
+	void			*dev_id;
+	bool			enabled;
+};
+
+static struct sim_irq sim_irqs[SIM_MAX_AMPS + 1];
+
+struct gpio_desc *devm_gpiod_get_optional(struct device *dev,
+					  const char *con_id,
+					  enum gpiod_flags flags)
+{
+	struct i2c_client *client = container_of(dev, struct i2c_client, dev);
+	struct sim_amp *amp = sim_amp_find(client->addr);
+	struct gpio_desc *desc;
+
+	if (!sim_gpio.fault_pin || strcmp(con_id, "fault") || !amp)
+		return NULL;
+
+	desc = devm_kzalloc(dev, sizeof(*desc), GFP_KERNEL);
+	if (!desc)
+		return ERR_PTR(-ENOMEM);
+
+	desc->irq = amp->irq;
+	return desc;
+}
+
+int gpiod_to_irq(const struct gpio_desc *desc)
+{
+	return desc->irq;
+}
+
+int gpiod_is_active_low(const struct gpio_desc *desc)
+{
+	return 1;
+}
+
+int devm_request_threaded_irq(struct device *dev, unsigned int irq,
+			      irq_handler_t handler, irq_handler_t thread_fn,
+			      unsigned long irqflags, const char *devname,
+			      void *dev_id)
+{
+	if (!irq || irq >= ARRAY_SIZE(sim_irqs) || sim_irqs[irq].thread_fn)
+		return -EINVAL;
+
+	sim_irqs[irq].thread_fn = thread_fn;
+	sim_irqs[irq].dev_id = dev_id;
+	sim_irqs[irq].enabled = true;
+
+	return 0;
+}
+
+void disable_irq(unsigned int irq)
+{
+	sim_irqs[irq].enabled = false;
+}
+
+void enable_irq(unsigned int irq)
+{
+	sim_irqs[irq].enabled = true;
+}
+
+/* Called from a timer, so nothing is on the stack but the simulator */
+void sim_irq_raise(unsigned int irq)
+{
+	struct sim_irq *i = &sim_irqs[irq];
+
+	if (irq < ARRAY_SIZE(sim_irqs) && i->enabled && i->thread_fn)
+		i->thread_fn(irq, i->dev_id);
+}
+
+/* hwmon and thermal registration only has to succeed. As in the
+ * kernel, a cooling device needs CONFIG_THERMAL.
+ */
+struct device *hwmon_device_register_with_info(struct device *dev,
+		const char *name, void *drvdata,
+		const struct hwmon_chip_info *info,
+		const void *extra_groups)
+{
+	return dev;
+}
+
+void hwmon_device_unregister(struct device *dev)
+{
+}
+
+struct thermal_cooling_device *
+thermal_of_cooling_device_register(struct device_node *np,
+		const char *type, void *devdata,
+		const struct thermal_cooling_device_ops *ops)
+{
+	struct thermal_cooling_device *cdev;
+
+	if (!IS_ENABLED(CONFIG_THERMAL))
+		return ERR_PTR(-ENODEV);
+
+	cdev = kzalloc(sizeof(*cdev), GFP_KERNEL);
+	if (!cdev)
+		return ERR_PTR(-ENOMEM);
+
+	cdev->devdata = devdata;
+	cdev->ops = ops;
+
+	return cdev;
+}
+
+void thermal_cooling_device_unregister(struct thermal_cooling_device *cdev)
+{
+	kfree(cdev);
+}
@@ -0,0 +1,1090 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Run one amplifier driver through a playback session against the
+// simulated bus and report what each step cost on the wire.
+//
+
+#include <getopt.h>
+#include <time.h>
+
+#include "sim.h"
+
+struct sim_fault {
+	struct sim_timer	timer;
+	unsigned int		at_ms;
+	unsigned int		hold_ms;
+	u8			val;
+	int			amp;
+};
+
+#define SIM_MAX_FAULTS	8
+
+static struct sim_fault sim_faults[SIM_MAX_FAULTS];
+static int sim_num_faults;
+
+static unsigned int sim_play_ms = 1000;
+static unsigned int sim_fmt = SND_SOC_DAIFMT_I2S | SND_SOC_DAIFMT_NB_NF |
+			      SND_SOC_DAIFMT_CBC_CFC;
+static unsigned short sim_group;
+static const char *sim_config;
+static bool sim_cooling;
+static s64 sim_max_spread = -1;
+
+#define SIM_MAX_PROFILES	8
+
+static const char *sim_profiles[SIM_MAX_PROFILES + 1];
+static int sim_num_profiles;
+static const char *sim_reload_dir;
+
+static struct i2c_adapter sim_adapter;
+static struct i2c_client *sim_clients[SIM_MAX_AMPS];
+static struct sim_prop sim_props[SIM_MAX_AMPS][5];
+
+struct sim_step {
+	const char		*name;
+	struct sim_io		io;
+	s64			ns;
+	int			ret;
+	bool			stray_page;
+	bool			over_budget;
+};
+
+/* Upper bounds on what one step may put on the bus, U64_MAX if
+ * unbounded
+ */
+struct sim_budget {
+	char			step[16];
+	u64			xfers;
+	u64			bytes;
+	u64			pages;
+	bool			used;
+};
+
+#define SIM_MAX_BUDGETS	16
+
+static struct sim_budget sim_budgets[SIM_MAX_BUDGETS];
+static int sim_num_budgets;
+
+/* What a stream start left behind: trigger to PLAY of the slowest
+ * amplifier, or -1 if one of them never got there.
+ */
+static s64 sim_latency(void)
+{
+	s64 latency = 0;
+	int i;
+
+	for (i = 0; i < sim_num_amps; i++) {
+		struct sim_amp *amp = &sim_amps[i];
+
+		if (!sim_amp_playing(amp) ||
+		    amp->play_time < sim_card.trigger_time)
+			return -1;
+
+		latency = max(latency, amp->play_time - sim_card.trigger_time);
+	}
+
+	return latency;
+}
+
+/* Time from the first to the last amplifier entering PLAY in the last
+ * stream start, or -1 if one of them never got there.
+ */
+static s64 sim_spread(void)
+{
+	s64 first = 0, last = 0;
+	int i;
+
+	for (i = 0; i < sim_num_amps; i++) {
+		struct sim_amp *amp = &sim_amps[i];
+
+		if (!sim_amp_playing(amp) ||
+		    amp->play_time < sim_card.trigger_time)
+			return -1;
+
+		if (!i || amp->play_time < first)
+			first = amp->play_time;
+		last = max(last, amp->play_time);
+	}
+
+	return last - first;
+}
+
+static int sim_probe(void)
+{
+	struct sim_prop *prop;
+	struct i2c_client *client;
+	int i, ret;
+
+	for (i = 0; i < sim_num_amps; i++) {
+		prop = sim_props[i];
+		if (sim_group)
+			*prop++ = (struct sim_prop){ "acme,group-address",
+						    NULL, sim_group };
+		if (sim_config)
+			*prop++ = (struct sim_prop){ "acme,dsp-config-name",
+						    sim_config, 0 };
+		if (sim_cooling)
+			*prop++ = (struct sim_prop){ "#cooling-cells",
+						    NULL, 2 };
+		if (sim_num_profiles)
+			*prop++ = (struct sim_prop){ "acme,dsp-profiles",
+						    NULL, 0, sim_profiles };
+
+		client = calloc(1, sizeof(*client));
+		if (!client)
+			return -ENOMEM;
+
+		client->addr = sim_amps[i].addr;
+		client->adapter = &sim_adapter;
+		snprintf(client->name, sizeof(client->name), "%d-%04x",
+			 sim_adapter.nr, client->addr);
+		client->dev.name = client->name;
+		client->dev.props = sim_props[i];
+		INIT_LIST_HEAD(&client->dev.devres);
+		sim_clients[i] = client;
+
+		ret = sim_i2c_driver->probe_new(client);
+		sim_run();
+		if (ret)
+			return ret;
+	}
+
+	ret = sim_card_bind();
+	if (!ret && sim_fmt)
+		ret = sim_card_set_fmt(sim_fmt);
+
+	return ret;
+}
+
+static void sim_fault_fire(struct sim_timer *timer)
+{
+	struct sim_fault *f = container_of(timer, struct sim_fault, timer);
+
+	sim_amp_fault(&sim_amps[f->amp], f->val, f->hold_ms);
+}
+
+static int sim_cold_start(void)
+{
+	int i;
+
+	/* Faults are timed from the first stream start */
+	for (i = 0; i < sim_num_faults; i++) {
+		sim_faults[i].timer.fn = sim_fault_fire;
+		sim_timer_add(&sim_faults[i].timer,
+			      sim_now + (s64)sim_faults[i].at_ms *
+					NSEC_PER_MSEC);
+	}
+
+	return sim_card_start();
+}
+
+static int sim_play(void)
+{
+	sim_advance_ms(sim_play_ms);
+	return 0;
+}
+
+/* Step every volume control 6 dB down, going by its dB scale */
+static int sim_volume(void)
+{
+	struct snd_ctl_elem_value val;
+	struct snd_ctl_elem_info info;
+	struct snd_kcontrol *kctl;
+	unsigned int c, tlv[4], steps;
+	int i, ret;
+
+	for (i = 0; i < sim_card.num_codecs; i++) {
+		kctl = sim_ctl_find(sim_card.components[i],
+				    "Master Playback Volume");
+		if (!kctl)
+			return -ENOENT;
+
+		ret = sim_ctl_info(kctl, &info);
+		if (!ret)
+			ret = sim_ctl_tlv_read(kctl, tlv, sizeof(tlv));
+		if (!ret && (tlv[0] != SNDRV_CTL_TLVT_DB_SCALE ||
+			     !(tlv[3] & SNDRV_CTL_TLVD_DB_SCALE_MASK)))
+			ret = -EINVAL;
+		if (!ret)
+			ret = sim_ctl_get(kctl, &val);
+		if (ret)
+			return ret;
+
+		steps = DIV_ROUND_UP(600, tlv[3] & SNDRV_CTL_TLVD_DB_SCALE_MASK);
+		for (c = 0; c < info.count; c++)
+			val.value.integer.value[c] =
+				max(val.value.integer.value[c] - (long)steps,
+				    info.value.integer.min);
+
+		ret = sim_ctl_put(kctl, &val);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Shift the balance 3 dB to the right, on stereo amplifiers only */
+static int sim_balance(void)
+{
+	struct snd_ctl_elem_value val;
+	struct snd_kcontrol *kctl, *vol;
+	unsigned int tlv[4];
+	int i, ret;
+
+	for (i = 0; i < sim_card.num_codecs; i++) {
+		kctl = sim_ctl_find(sim_card.components[i],
+				    "Master Playback Balance");
+		vol = sim_ctl_find(sim_card.components[i],
+				   "Master Playback Volume");
+		if (!kctl)
+			continue;
+		if (!vol)
+			return -ENOENT;
+
+		ret = sim_ctl_tlv_read(vol, tlv, sizeof(tlv));
+		if (ret)
+			return ret;
+		if (!(tlv[3] & SNDRV_CTL_TLVD_DB_SCALE_MASK))
+			return -EINVAL;
+
+		memset(&val, 0, sizeof(val));
+		val.value.integer.value[0] =
+			DIV_ROUND_UP(300, tlv[3] & SNDRV_CTL_TLVD_DB_SCALE_MASK);
+		ret = sim_ctl_put(kctl, &val);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Switch every amplifier to the second DSP profile while playing */
+static int sim_profile(void)
+{
+	struct snd_ctl_elem_value val;
+	struct snd_kcontrol *kctl;
+	int i, ret;
+
+	for (i = 0; i < sim_card.num_codecs; i++) {
+		kctl = sim_ctl_find(sim_card.components[i], "DSP Profile");
+		if (!kctl)
+			return -ENOENT;
+
+		memset(&val, 0, sizeof(val));
+		val.value.enumerated.item[0] = 1;
+		ret = sim_ctl_put(kctl, &val);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Have every amplifier reload its tuning blobs from another directory */
+static int sim_reload(void)
+{
+	int i, ret;
+
+	sim_fw_dir = sim_reload_dir;
+
+	for (i = 0; i < sim_num_amps; i++) {
+		ret = sim_dev_attr_store(&sim_clients[i]->dev, "dsp_reload",
+					 "1");
+		sim_run();
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Read every debugfs file the drivers created, with the register
+ * dumps going over the bus, and reset the I/O statistics
+ */
+static int sim_debugfs(void)
+{
+	static char buf[16384];
+	struct dentry *d = NULL;
+	char path[64];
+	int ret;
+
+	while ((d = sim_debugfs_next(d))) {
+		sim_debugfs_path(d, path, sizeof(path));
+
+		ret = sim_debugfs_read(d, buf, sizeof(buf));
+		if (ret)
+			return ret;
+		if (sim_verbose)
+			printf("%s:\n%s", path, buf);
+
+		if (strcmp(strrchr(path, '/') + 1, "stats"))
+			continue;
+
+		ret = sim_debugfs_write(d, "0") ?:
+		      sim_debugfs_read(d, buf, sizeof(buf));
+		if (ret)
+			return ret;
+		if (!strstr(buf, "\nreads: 0\n"))
+			return -EIO;
+	}
+
+	return 0;
+}
+
+static int sim_mute_toggle(void)
+{
+	return sim_card_mute(1) ?: sim_card_mute(0);
+}
+
+static int sim_shutdown(void)
+{
+	int ret = sim_card_stop();
+
+	sim_advance_ms(sim_card.pmdown_ms);
+
+	return ret;
+}
+
+static int sim_remove(void)
+{
+	int i;
+
+	sim_card_unbind();
+
+	for (i = 0; i < sim_num_amps; i++) {
+		sim_i2c_driver->remove(sim_clients[i]);
+		sim_run();
+		sim_devres_release(&sim_clients[i]->dev);
+		free(sim_clients[i]);
+	}
+
+	return 0;
+}
+
+static struct sim_step sim_steps[16];
+static int sim_num_steps;
+
+/* Step names are matched with '-' or '_' standing in for spaces */
+static bool sim_step_match(const char *spec, const char *name)
+{
+	for (; *spec && *name; spec++, name++)
+		if (*spec != *name &&
+		    !(*name == ' ' && (*spec == '-' || *spec == '_')))
+			return false;
+
+	return !*spec && !*name;
+}
+
+static bool sim_check_budget(struct sim_step *step)
+{
+	struct sim_budget *b;
+	bool over = false;
+	int i;
+
+	for (i = 0; i < sim_num_budgets; i++) {
+		b = &sim_budgets[i];
+		if (!sim_step_match(b->step, step->name))
+			continue;
+
+		b->used = true;
+		if (step->io.xfers > b->xfers || step->io.bytes > b->bytes ||
+		    step->io.page_switches > b->pages)
+			over = true;
+	}
+
+	return over;
+}
+
+static int sim_step(const char *name, int (*fn)(void))
+{
+	struct sim_step *step = &sim_steps[sim_num_steps++];
+	struct sim_io before = sim_io;
+	ktime_t start = sim_now;
+	int i;
+
+	step->name = name;
+	step->ret = fn();
+
+	step->io.xfers = sim_io.xfers - before.xfers;
+	step->io.writes = sim_io.writes - before.writes;
+	step->io.reads = sim_io.reads - before.reads;
+	step->io.bytes = sim_io.bytes - before.bytes;
+	step->io.bus_ns = sim_io.bus_ns - before.bus_ns;
+	step->io.page_switches = sim_io.page_switches - before.page_switches;
+	step->io.errors = sim_io.errors - before.errors;
+	step->ns = sim_now - start;
+
+	/* The drivers expect page 0 between operations */
+	for (i = 0; i < sim_num_amps; i++)
+		if (sim_amps[i].page)
+			step->stray_page = true;
+
+	step->over_budget = sim_check_budget(step);
+
+	printf("%-12s %7llu %7llu %7llu %8llu %6llu %10.1f %10.1f  %s%s%s\n",
+	       name, step->io.xfers, step->io.writes, step->io.reads,
+	       step->io.bytes, step->io.page_switches,
+	       step->io.bus_ns / 1000.0, step->ns / 1000.0,
+	       step->ret < 0 ? strerror(-step->ret) : "ok",
+	       step->stray_page ? ", left off page 0" : "",
+	       step->over_budget ? ", over budget" : "");
+
+	if (step->ret < 0)
+		return step->ret;
+
+	return step->over_budget || step->stray_page ? -EDQUOT : 0;
+}
+
+/* Benchmark: repeated stream starts, each through the trigger, the
+ * start work and the DAPM event of every driver instance.
+ */
+#define SIM_BENCH_PAGES	16
+
+/* The path a start took: DSP rebooted and blob sent, or the
+ * configuration found in place
+ */
+enum {
+	SIM_PATH_UPLOAD,
+	SIM_PATH_KEEP,
+	SIM_PATHS,
+};
+
+static const char * const sim_path_names[] = { "upload", "keep" };
+
+struct sim_bench_run {
+	s64			*latency;
+	unsigned int		runs;
+	unsigned int		failed;
+	u64			bytes;
+	s64			cpu_ns;
+};
+
+static s64 sim_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (s64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* A tuning blob that fills SIM_BENCH_PAGES coefficient pages, several
+ * times the size of the built-in default. It leaves the amplifier in
+ * Hi-Z for the driver to start.
+ */
+static u8 *sim_bench_blob(const struct sim_chip *chip, size_t *len)
+{
+	u8 *blob, *p;
+	unsigned int page, reg;
+
+	blob = malloc(2 + SIM_BENCH_PAGES * 2 * (1 + 0x78) + 4);
+	if (!blob)
+		return NULL;
+
+	p = blob;
+	for (page = 1; page <= SIM_BENCH_PAGES; page++) {
+		*p++ = 0x00;
+		*p++ = page;
+		for (reg = 0x08; reg < 0x80; reg++) {
+			*p++ = reg;
+			*p++ = get_random_u32();
+		}
+	}
+	*p++ = 0x00;
+	*p++ = 0x00;
+	*p++ = chip->state_reg;
+	*p++ = chip->state_hiz;
+
+	*len = p - blob;
+	return blob;
+}
+
+static unsigned int sim_resets(void)
+{
+	unsigned int resets = 0;
+	int i;
+
+	for (i = 0; i < sim_num_amps; i++)
+		resets += sim_amps[i].resets;
+
+	return resets;
+}
+
+/* Start a stream and account for it under the path it took */
+static int sim_bench_start(struct sim_bench_run *runs)
+{
+	struct sim_io before = sim_io;
+	unsigned int resets = sim_resets();
+	s64 cpu = sim_cpu_ns(), latency;
+	struct sim_bench_run *run;
+	int ret;
+
+	ret = sim_card_start();
+	cpu = sim_cpu_ns() - cpu;
+
+	run = &runs[sim_resets() != resets ? SIM_PATH_UPLOAD : SIM_PATH_KEEP];
+	run->cpu_ns += cpu;
+	run->bytes += sim_io.bytes - before.bytes;
+
+	latency = sim_latency();
+	if (ret || latency < 0)
+		run->failed++;
+	else
+		run->latency[run->runs++] = latency;
+
+	sim_advance_ms(sim_play_ms);
+
+	return sim_card_stop();
+}
+
+static int sim_s64_cmp(const void *a, const void *b)
+{
+	s64 x = *(const s64 *)a, y = *(const s64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Nearest rank */
+static double sim_percentile_us(const s64 *v, unsigned int n,
+				unsigned int pct)
+{
+	unsigned int rank = (n * pct + 99) / 100;
+
+	return v[rank ? rank - 1 : 0] / 1000.0;
+}
+
+static void sim_bench_report(const char *blob, const char *start,
+			     const char *path, struct sim_bench_run *run)
+{
+	unsigned int n = run->runs + run->failed;
+
+	if (!n)
+		return;
+
+	printf("%-6s %-5s %-6s %6u %6u", blob, start, path, n, run->failed);
+	if (!run->runs) {
+		printf("\n");
+		return;
+	}
+
+	qsort(run->latency, run->runs, sizeof(*run->latency), sim_s64_cmp);
+	printf(" %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+	       sim_percentile_us(run->latency, run->runs, 50),
+	       sim_percentile_us(run->latency, run->runs, 99),
+	       run->latency[run->runs - 1] / 1000.0,
+	       (double)run->bytes / n, run->cpu_ns / 1000.0 / n);
+}
+
+/* Cold starts come after DAPM powered the DAC down, warm starts within
+ * pmdown_time of the previous stop. Each is reported under the path it
+ * took, since a warm start may upload again or keep the configuration.
+ */
+static int sim_bench(const struct sim_chip *chip, int amps,
+		     unsigned int runs)
+{
+	static const char * const blobs[] = { "stock", "large" };
+	struct sim_bench_run cold[SIM_PATHS] = {}, warm[SIM_PATHS] = {};
+	char name[64];
+	size_t len = 0;
+	u8 *large;
+	unsigned int n;
+	int b, i, p, ret, err = 0;
+
+	large = sim_bench_blob(chip, &len);
+	if (!large)
+		return -ENOMEM;
+	for (p = 0; p < SIM_PATHS; p++) {
+		cold[p].latency = calloc(runs, sizeof(s64));
+		warm[p].latency = calloc(runs, sizeof(s64));
+		if (!cold[p].latency || !warm[p].latency)
+			return -ENOMEM;
+	}
+
+	snprintf(name, sizeof(name), "%s_dsp_bench_large.bin", chip->name);
+	sim_fw_add(name, large, len);
+
+	printf("%u runs per start, %u ms playing, large blob %zu bytes\n",
+	       runs, sim_play_ms, len);
+	printf("%-6s %-5s %-6s %6s %6s %10s %10s %10s %10s %10s\n", "blob",
+	       "start", "path", "runs", "failed", "p50_us", "p99_us",
+	       "max_us", "bytes", "cpu_us");
+
+	for (b = 0; b < ARRAY_SIZE(blobs); b++) {
+		sim_config = b ? "bench_large" : NULL;
+
+		sim_num_amps = 0;
+		for (i = 0; i < amps; i++)
+			sim_amp_add(chip, SIM_BASE_ADDR + i, sim_group);
+
+		ret = sim_probe();
+		if (ret) {
+			fprintf(stderr, "probe failed: %s\n", strerror(-ret));
+			return ret;
+		}
+
+		for (p = 0; p < SIM_PATHS; p++) {
+			cold[p].runs = cold[p].failed = 0;
+			warm[p].runs = warm[p].failed = 0;
+			cold[p].bytes = warm[p].bytes = 0;
+			cold[p].cpu_ns = warm[p].cpu_ns = 0;
+		}
+
+		for (n = 0; n < runs; n++) {
+			err |= sim_bench_start(cold);
+			sim_advance_ms(sim_card.pmdown_ms);
+		}
+
+		/* The first warm start needs a stream before it */
+		err |= sim_card_start() ?: sim_card_stop();
+		for (n = 0; n < runs; n++)
+			err |= sim_bench_start(warm);
+
+		for (p = 0; p < SIM_PATHS; p++)
+			sim_bench_report(blobs[b], "cold", sim_path_names[p],
+					 &cold[p]);
+		for (p = 0; p < SIM_PATHS; p++)
+			sim_bench_report(blobs[b], "warm", sim_path_names[p],
+					 &warm[p]);
+		for (p = 0; p < SIM_PATHS; p++)
+			err |= cold[p].failed || warm[p].failed;
+
+		sim_shutdown();
+		sim_remove();
+	}
+
+	for (p = 0; p < SIM_PATHS; p++) {
+		free(cold[p].latency);
+		free(warm[p].latency);
+	}
+	free(large);
+
+	return err ? -EIO : 0;
+}
+
+static void sim_print_latency(const char *name, s64 ns)
+{
+	if (ns < 0)
+		printf("trigger to PLAY (%s): not playing\n", name);
+	else
+		printf("trigger to PLAY (%s): %.1f us\n", name, ns / 1000.0);
+}
+
+/* Returns true if the spread is over --max-spread */
+static bool sim_print_spread(const char *name, s64 ns)
+{
+	bool over = sim_max_spread >= 0 && ns > sim_max_spread;
+
+	if (ns >= 0)
+		printf("PLAY spread (%s): %.1f us%s\n", name, ns / 1000.0,
+		       over ? "  over limit" : "");
+
+	return over;
+}
+
+static unsigned int sim_parse_freq(const char *s)
+{
+	char *end;
+	double f = strtod(s, &end);
+
+	if (*end == 'k' || *end == 'K')
+		f *= 1000;
+	else if (*end == 'M' || *end == 'm')
+		f *= 1000000;
+
+	return f;
+}
+
+static unsigned int sim_parse_fmt(const char *s)
+{
+	static const struct {
+		const char	*name;
+		unsigned int	fmt;
+	} fmts[] = {
+		{ "none",	0 },
+		{ "i2s",	SND_SOC_DAIFMT_I2S },
+		{ "left_j",	SND_SOC_DAIFMT_LEFT_J },
+		{ "dsp_a",	SND_SOC_DAIFMT_DSP_A },
+		{ "dsp_b",	SND_SOC_DAIFMT_DSP_B },
+	};
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(fmts); i++)
+		if (!strcmp(fmts[i].name, s))
+			return fmts[i].fmt ? fmts[i].fmt |
+				SND_SOC_DAIFMT_NB_NF |
+				SND_SOC_DAIFMT_CBC_CFC : 0;
+
+	fprintf(stderr, "unknown format '%s'\n", s);
+	exit(2);
+}
+
+static int sim_parse_fault(const char *s)
+{
+	struct sim_fault *f = &sim_faults[sim_num_faults];
+	unsigned int val;
+	const char *at;
+
+	if (sim_num_faults == SIM_MAX_FAULTS)
+		return -ENOSPC;
+
+	memset(f, 0, sizeof(*f));
+	if (sscanf(s, "%u:%i:%u", &f->at_ms, &val, &f->hold_ms) < 2)
+		return -EINVAL;
+	f->val = val;
+
+	at = strchr(s, '@');
+	if (at)
+		f->amp = atoi(at + 1);
+
+	sim_num_faults++;
+	return 0;
+}
+
+/* N or N..M, the transactions to fail */
+static int sim_parse_fail(const char *s)
+{
+	u64 first, last;
+	char *end;
+
+	first = strtoull(s, &end, 0);
+	last = first;
+	if (!strncmp(end, "..", 2))
+		last = strtoull(end + 2, &end, 0);
+	if (end == s || *end || !first || last < first)
+		return -EINVAL;
+
+	return sim_fail_xfer(first, last);
+}
+
+/* One field of a budget. An empty one leaves it unbounded. */
+static const char *sim_parse_bound(const char *s, u64 *val)
+{
+	char *end;
+
+	if (!*s || *s == ':')
+		return s;
+
+	*val = strtoull(s, &end, 0);
+	return end;
+}
+
+/* STEP=XFERS[:BYTES[:PAGES]] */
+static int sim_parse_budget(const char *s)
+{
+	struct sim_budget *b = &sim_budgets[sim_num_budgets];
+	const char *eq = strchr(s, '=');
+	const char *end;
+
+	if (sim_num_budgets == SIM_MAX_BUDGETS)
+		return -ENOSPC;
+
+	if (!eq || eq == s || eq - s >= sizeof(b->step))
+		return -EINVAL;
+
+	memset(b, 0, sizeof(*b));
+	memcpy(b->step, s, eq - s);
+
+	b->xfers = b->bytes = b->pages = U64_MAX;
+	end = sim_parse_bound(eq + 1, &b->xfers);
+	if (*end == ':')
+		end = sim_parse_bound(end + 1, &b->bytes);
+	if (*end == ':')
+		end = sim_parse_bound(end + 1, &b->pages);
+	if (*end)
+		return -EINVAL;
+
+	sim_num_budgets++;
+	return 0;
+}
+
+/* A comma separated list of profile names */
+static int sim_parse_profiles(char *s)
+{
+	char *name;
+
+	sim_num_profiles = 0;
+	while ((name = strsep(&s, ","))) {
+		if (!*name || sim_num_profiles == SIM_MAX_PROFILES)
+			return -EINVAL;
+		sim_profiles[sim_num_profiles++] = name;
+	}
+	sim_profiles[sim_num_profiles] = NULL;
+
+	return 0;
+}
+
+static void sim_usage(FILE *f, const char *prog)
+{
+	fprintf(f,
+"usage: %s [options]\n"
+"\n"
+"Runs the %s driver through probe, cold start, playback, a volume\n"
+"change, a mute toggle, stop, warm start, shutdown and remove against\n"
+"a simulated register file, and reports the bus traffic of each step.\n"
+"\n"
+"  -f, --freq HZ            I2C clock: 100k, 400k (default) or 1M\n"
+"  -o, --overhead US        fixed cost per transaction (default 0)\n"
+"  -n, --amps N             amplifiers on the DAI link (default 1, max %d)\n"
+"  -g, --group ADDR         give them a common broadcast address\n"
+"  -F, --fw-dir DIR         load tuning blobs from DIR\n"
+"  -c, --config NAME        acme,dsp-config-name property\n"
+"      --profiles A,B,...   acme,dsp-profiles property; with two or more\n"
+"                           the session switches to B while playing\n"
+"      --reload DIR         reload the tuning blobs from DIR while playing\n"
+"      --fmt FMT            DAI format set at bind: none, i2s (default),\n"
+"                           left_j, dsp_a, dsp_b\n"
+"      --cooling            add a #cooling-cells property\n"
+"  -p, --param NAME=VAL     set a module parameter, see below\n"
+"  -t, --play MS            time spent playing after the cold start\n"
+"                           (default 1000)\n"
+"      --pmdown MS          DAPM power down delay (default 5000)\n"
+"      --fault MS:VAL[:HOLD][@AMP]\n"
+"                           latch VAL in the first fault register MS\n"
+"                           after the cold start, with the condition\n"
+"                           lasting HOLD ms\n"
+"      --fault-pin          wire up the FAULT pin instead of polling\n"
+"      --fail N[..M]        NAK the Nth bus transaction, or the Nth to\n"
+"                           the Mth (repeatable); the cold start may then\n"
+"                           fail, the warm start has to recover\n"
+"      --budget STEP=XFERS[:BYTES[:PAGES]]\n"
+"                           fail if STEP (e.g. warm-start) takes more\n"
+"                           transactions, bytes or page switches\n"
+"                           (repeatable, an empty field is unbounded)\n"
+"      --max-spread US      fail if the amplifiers enter PLAY more than\n"
+"                           US apart in a stream start\n"
+"      --bench N            instead of the session, time N cold and N\n"
+"                           warm starts with the stock and a large blob\n"
+"  -s, --seed N             seed for get_random_u32()\n"
+"  -v, --verbose            driver log; twice for debug messages\n"
+"  -h, --help\n",
+		prog, sim_i2c_driver->driver.name, SIM_MAX_AMPS);
+	sim_list_params(f);
+}
+
+enum {
+	OPT_FMT = 256,
+	OPT_COOLING,
+	OPT_PMDOWN,
+	OPT_FAULT,
+	OPT_FAULT_PIN,
+	OPT_FAIL,
+	OPT_BUDGET,
+	OPT_BENCH,
+	OPT_PROFILES,
+	OPT_RELOAD,
+	OPT_MAX_SPREAD,
+};
+
+static const struct option sim_options[] = {
+	{ "freq",	required_argument,	NULL, 'f' },
+	{ "overhead",	required_argument,	NULL, 'o' },
+	{ "amps",	required_argument,	NULL, 'n' },
+	{ "group",	required_argument,	NULL, 'g' },
+	{ "fw-dir",	required_argument,	NULL, 'F' },
+	{ "config",	required_argument,	NULL, 'c' },
+	{ "profiles",	required_argument,	NULL, OPT_PROFILES },
+	{ "reload",	required_argument,	NULL, OPT_RELOAD },
+	{ "fmt",	required_argument,	NULL, OPT_FMT },
+	{ "cooling",	no_argument,		NULL, OPT_COOLING },
+	{ "param",	required_argument,	NULL, 'p' },
+	{ "play",	required_argument,	NULL, 't' },
+	{ "pmdown",	required_argument,	NULL, OPT_PMDOWN },
+	{ "fault",	required_argument,	NULL, OPT_FAULT },
+	{ "fault-pin",	no_argument,		NULL, OPT_FAULT_PIN },
+	{ "fail",	required_argument,	NULL, OPT_FAIL },
+	{ "budget",	required_argument,	NULL, OPT_BUDGET },
+	{ "max-spread",	required_argument,	NULL, OPT_MAX_SPREAD },
+	{ "bench",	required_argument,	NULL, OPT_BENCH },
+	{ "seed",	required_argument,	NULL, 's' },
+	{ "verbose",	no_argument,		NULL, 'v' },
+	{ "help",	no_argument,		NULL, 'h' },
+	{ }
+};
+
+int main(int argc, char **argv)
+{
+	const struct sim_chip *chip;
+	int amps = 1, opt, i, ret, err = 0;
+	unsigned int bench = 0;
+	bool nak = false;
+	s64 cold, warm, cold_spread, warm_spread;
+
+	chip = sim_chip_find(sim_i2c_driver->driver.name);
+	if (!chip) {
+		fprintf(stderr, "no register model for %s\n",
+			sim_i2c_driver->driver.name);
+		return 2;
+	}
+
+	/* Keep the table in step with the driver log on stderr */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	while ((opt = getopt_long(argc, argv, "f:o:n:g:F:c:p:t:s:vh",
+				  sim_options, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			sim_bus.freq_hz = sim_parse_freq(optarg);
+			break;
+		case 'o':
+			sim_bus.overhead_ns = strtoul(optarg, NULL, 0) *
+					      NSEC_PER_USEC;
+			break;
+		case 'n':
+			amps = atoi(optarg);
+			break;
+		case 'g':
+			sim_group = strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			sim_fw_dir = optarg;
+			break;
+		case 'c':
+			sim_config = optarg;
+			break;
+		case OPT_PROFILES:
+			if (sim_parse_profiles(optarg)) {
+				fprintf(stderr, "bad profiles '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case OPT_RELOAD:
+			sim_reload_dir = optarg;
+			break;
+		case OPT_FMT:
+			sim_fmt = sim_parse_fmt(optarg);
+			break;
+		case OPT_COOLING:
+			sim_cooling = true;
+			break;
+		case 'p':
+			if (sim_set_param(optarg)) {
+				fprintf(stderr, "unknown parameter '%s'\n",
+					optarg);
+				return 2;
+			}
+			break;
+		case 't':
+			sim_play_ms = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_PMDOWN:
+			sim_card.pmdown_ms = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_FAULT:
+			if (sim_parse_fault(optarg)) {
+				fprintf(stderr, "bad fault '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case OPT_FAULT_PIN:
+			sim_gpio.fault_pin = true;
+			break;
+		case OPT_FAIL:
+			ret = sim_parse_fail(optarg);
+			if (ret == -ENOSPC) {
+				fprintf(stderr, "too many --fail\n");
+				return 2;
+			} else if (ret) {
+				fprintf(stderr, "bad fail '%s'\n", optarg);
+				return 2;
+			}
+			nak = true;
+			break;
+		case OPT_BUDGET:
+			if (sim_parse_budget(optarg)) {
+				fprintf(stderr, "bad budget '%s'\n", optarg);
+				return 2;
+			}
+			break;
+		case OPT_MAX_SPREAD:
+			sim_max_spread = (s64)(strtod(optarg, NULL) *
+					       NSEC_PER_USEC);
+			break;
+		case OPT_BENCH:
+			bench = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sim_seed(strtoul(optarg, NULL, 0));
+			break;
+		case 'v':
+			sim_verbose++;
+			break;
+		case 'h':
+			sim_usage(stdout, argv[0]);
+			return 0;
+		default:
+			sim_usage(stderr, argv[0]);
+			return 2;
+		}
+	}
+
+	if (amps < 1 || amps > SIM_MAX_AMPS || !sim_bus.freq_hz) {
+		sim_usage(stderr, argv[0]);
+		return 2;
+	}
+
+	for (i = 0; i < sim_num_faults; i++) {
+		if (sim_faults[i].amp >= amps) {
+			fprintf(stderr, "fault on amplifier %d of %d\n",
+				sim_faults[i].amp, amps);
+			return 2;
+		}
+	}
+
+	for (i = 0; i < amps; i++)
+		sim_amp_add(chip, SIM_BASE_ADDR + i, sim_group);
+
+	printf("%s: %d amplifier%s, %u Hz bus, %u us per transaction%s\n",
+	       chip->name, amps, amps > 1 ? "s" : "", sim_bus.freq_hz,
+	       sim_bus.overhead_ns / 1000, sim_group ? ", grouped" : "");
+
+	if (bench)
+		return !!sim_bench(chip, amps, bench);
+
+	printf("%-12s %7s %7s %7s %8s %6s %10s %10s  %s\n", "step", "xfers",
+	       "writes", "reads", "bytes", "pages", "bus_us", "time_us",
+	       "result");
+
+	if (sim_step("probe", sim_probe))
+		return 1;
+
+	err |= sim_step("cold start", sim_cold_start);
+	cold = sim_latency();
+	cold_spread = sim_spread();
+	err |= sim_step("play", sim_play);
+	err |= sim_step("volume", sim_volume);
+	err |= sim_step("balance", sim_balance);
+	if (sim_num_profiles > 1)
+		err |= sim_step("profile", sim_profile);
+	if (sim_reload_dir)
+		err |= sim_step("reload", sim_reload);
+	err |= sim_step("mute", sim_mute_toggle);
+	err |= sim_step("stop", sim_card_stop);
+	err |= sim_step("warm start", sim_card_start);
+	warm = sim_latency();
+	warm_spread = sim_spread();
+	if (IS_ENABLED(CONFIG_DEBUG_FS))
+		err |= sim_step("debugfs", sim_debugfs);
+	err |= sim_step("shutdown", sim_shutdown);
+	err |= sim_step("remove", sim_remove);
+
+	sim_print_latency("cold", cold);
+	sim_print_latency("warm", warm);
+	if (sim_num_amps > 1) {
+		err |= sim_print_spread("cold", cold_spread);
+		err |= sim_print_spread("warm", warm_spread);
+	}
+
+	/* A budget that matched nothing would pass forever */
+	for (i = 0; i < sim_num_budgets; i++) {
+		if (!sim_budgets[i].used) {
+			fprintf(stderr, "budget for unknown step '%s'\n",
+				sim_budgets[i].step);
+			err = 1;
+		}
+	}
+
+	/* A cold start that ran into --fail need not play, but the driver
+	 * has to be back in shape for the warm start
+	 */
+	return err || (cold < 0 && !nak) || warm < 0;
+}
@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Simulator internals shared by the kernel shims, the bus and device
+ * model, and the scenario driver. Nothing here is visible to the
+ * amplifier drivers.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <ksim.h>
+
+#define SIM_MAX_AMPS	4
+#define SIM_BASE_ADDR	0x2c
+
+extern struct i2c_driver *sim_i2c_driver;
+
+/* kernel.c */
+extern int sim_verbose;
+extern ktime_t sim_now;
+
+void sim_seed(u32 seed);
+int sim_set_param(const char *arg);
+void sim_list_params(FILE *f);
+
+void sim_timer_add(struct sim_timer *timer, ktime_t expires);
+void sim_timer_del(struct sim_timer *timer);
+
+/* Run queued work and expired timers until nothing is left to do at
+ * the current time, or move the clock forward by ms doing the same.
+ */
+void sim_run(void);
+void sim_advance_ms(unsigned int ms);
+
+void sim_devres_release(struct device *dev);
+
+extern const char *sim_fw_dir;
+
+/* Write to a sysfs attribute the driver adds to its devices */
+int sim_dev_attr_store(struct device *dev, const char *name,
+		       const char *buf);
+
+/* Walk the debugfs files the drivers created, and read or write one
+ * of them the way a shell would. Reads fill buf up to size.
+ */
+struct dentry *sim_debugfs_next(struct dentry *d);
+void sim_debugfs_path(const struct dentry *d, char *buf, size_t size);
+int sim_debugfs_read(struct dentry *d, char *buf, size_t size);
+int sim_debugfs_write(struct dentry *d, const char *buf);
+
+/* Serve a firmware file from memory, ahead of sim_fw_dir */
+int sim_fw_add(const char *name, const void *data, size_t size);
+
+/* Set up by main.c before a driver probes */
+struct sim_gpio_cfg {
+	bool			fault_pin;
+};
+extern struct sim_gpio_cfg sim_gpio;
+
+void sim_irq_raise(unsigned int irq);
+
+/* i2c.c: bus timing, accounting and the register file model */
+struct sim_bus_cfg {
+	unsigned int		freq_hz;
+	unsigned int		overhead_ns;
+};
+extern struct sim_bus_cfg sim_bus;
+
+struct sim_io {
+	u64			xfers;
+	u64			writes;
+	u64			reads;
+	u64			bytes;
+	u64			bus_ns;
+	u64			page_switches;
+	u64			errors;
+};
+extern struct sim_io sim_io;
+
+/* Fail the transactions first to last (1-based count) with a NAK */
+int sim_fail_xfer(u64 first, u64 last);
+
+struct sim_chip {
+	const char		*name;
+	unsigned int		state_reg;
+	unsigned int		state_mask;
+	unsigned int		state_hiz;
+	unsigned int		state_play;
+	unsigned int		report_reg;	/* 0 if none */
+	unsigned int		fault_reg;
+	unsigned int		fault_len;
+	unsigned int		temp_reg;	/* 0 if none */
+};
+
+struct sim_amp {
+	const struct sim_chip	*chip;
+	unsigned short		addr;
+	unsigned short		group;
+	unsigned int		irq;
+
+	u8			page;
+	u8			regs[256][256];
+	u8			temp;
+
+	/* Fault condition and the registers latching it */
+	ktime_t			fault_until;
+	bool			fault_latched;
+	u8			fault_val;
+
+	/* Time the amplifier last entered PLAY */
+	ktime_t			play_time;
+	unsigned int		transitions;
+	/* Writes of deep sleep, which reboot the DSP */
+	unsigned int		resets;
+};
+
+extern struct sim_amp sim_amps[SIM_MAX_AMPS];
+extern int sim_num_amps;
+
+const struct sim_chip *sim_chip_find(const char *name);
+struct sim_amp *sim_amp_add(const struct sim_chip *chip, unsigned short addr,
+			    unsigned short group);
+struct sim_amp *sim_amp_find(unsigned short addr);
+bool sim_amp_playing(const struct sim_amp *amp);
+void sim_amp_fault(struct sim_amp *amp, u8 val, unsigned int hold_ms);
+
+/* soc.c: the parts of the ASoC core a machine driver would drive */
+struct sim_card {
+	int			num_codecs;
+	struct snd_soc_component *components[SIM_MAX_AMPS];
+	struct snd_soc_dai	*dais[SIM_MAX_AMPS];
+	struct snd_soc_pcm_runtime rtd;
+	struct snd_pcm_substream substream;
+	bool			running;
+	bool			powered;
+	ktime_t			trigger_time;
+	unsigned int		pmdown_ms;
+	struct sim_timer	pmdown;
+};
+extern struct sim_card sim_card;
+
+int sim_card_bind(void);
+void sim_card_unbind(void);
+int sim_card_set_fmt(unsigned int fmt);
+int sim_card_start(void);
+int sim_card_stop(void);
+int sim_card_mute(int mute);
+void sim_card_power_down(void);
+struct snd_kcontrol *sim_ctl_find(struct snd_soc_component *component,
+				  const char *name);
+int sim_ctl_get(struct snd_kcontrol *kctl, struct snd_ctl_elem_value *val);
+int sim_ctl_put(struct snd_kcontrol *kctl, struct snd_ctl_elem_value *val);
+int sim_ctl_info(struct snd_kcontrol *kctl, struct snd_ctl_elem_info *info);
+/* Read the TLV data of a control, as SNDRV_CTL_IOCTL_TLV_READ does */
+int sim_ctl_tlv_read(struct snd_kcontrol *kctl, unsigned int *tlv,
+		     unsigned int size);
+
+#endif
@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Just enough of the ASoC core to drive the codec drivers the way a
+// card with one playback DAI link would: component registration,
+// controls, DAPM power events and the PCM operations on the link.
+//
+
+#include "sim.h"
+
+struct sim_card sim_card = {
+	.pmdown_ms	= 5000,
+};
+
+struct sim_component {
+	struct snd_soc_component	component;
+	struct snd_soc_dai		dai;
+};
+
+static LIST_HEAD(sim_components);
+
+int snd_soc_register_component(struct device *dev,
+			const struct snd_soc_component_driver *component_driver,
+			struct snd_soc_dai_driver *dai_drv, int num_dai)
+{
+	struct sim_component *sc;
+
+	if (num_dai != 1)
+		return -EINVAL;
+
+	sc = calloc(1, sizeof(*sc));
+	if (!sc)
+		return -ENOMEM;
+
+	sc->component.name = dev_name(dev);
+	sc->component.dev = dev;
+	sc->component.driver = component_driver;
+	sc->component.dapm.component = &sc->component;
+	INIT_LIST_HEAD(&sc->component.controls);
+
+	sc->dai.name = dai_drv->name;
+	sc->dai.dev = dev;
+	sc->dai.driver = dai_drv;
+	sc->dai.component = &sc->component;
+
+	list_add_tail(&sc->component.list, &sim_components);
+
+	return 0;
+}
+
+static void sim_free_controls(struct snd_soc_component *component)
+{
+	struct snd_kcontrol *kctl, *tmp;
+
+	list_for_each_entry_safe(kctl, tmp, &component->controls, list) {
+		list_del(&kctl->list);
+		free(kctl);
+	}
+}
+
+void snd_soc_unregister_component(struct device *dev)
+{
+	struct snd_soc_component *component;
+
+	list_for_each_entry(component, &sim_components, list) {
+		if (component->dev != dev)
+			continue;
+
+		list_del(&component->list);
+		sim_free_controls(component);
+		free(container_of(component, struct sim_component, component));
+		return;
+	}
+}
+
+int snd_soc_add_component_controls(struct snd_soc_component *component,
+				   const struct snd_kcontrol_new *controls,
+				   unsigned int num_controls)
+{
+	struct snd_kcontrol *kctl;
+	unsigned int i;
+
+	for (i = 0; i < num_controls; i++) {
+		if (sim_ctl_find(component, controls[i].name))
+			return -EBUSY;
+
+		kctl = calloc(1, sizeof(*kctl));
+		if (!kctl)
+			return -ENOMEM;
+
+		kctl->new = controls[i];
+		kctl->private_value = controls[i].private_value;
+		kctl->private_data = component;
+		list_add_tail(&kctl->list, &component->controls);
+	}
+
+	return 0;
+}
+
+struct snd_kcontrol *sim_ctl_find(struct snd_soc_component *component,
+				  const char *name)
+{
+	struct snd_kcontrol *kctl;
+
+	list_for_each_entry(kctl, &component->controls, list)
+		if (!strcmp(kctl->new.name, name))
+			return kctl;
+
+	return NULL;
+}
+
+int snd_soc_component_notify_control(struct snd_soc_component *component,
+				     const char * const ctl)
+{
+	if (!sim_ctl_find(component, ctl)) {
+		dev_err(component->dev, "sim: notify for unknown control '%s'\n",
+			ctl);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int snd_ctl_enum_info(struct snd_ctl_elem_info *info, unsigned int channels,
+		      unsigned int items, const char *const names[])
+{
+	info->type = SNDRV_CTL_ELEM_TYPE_ENUMERATED;
+	info->count = channels;
+	info->value.enumerated.items = items;
+	if (!items)
+		return 0;
+	if (info->value.enumerated.item >= items)
+		info->value.enumerated.item = items - 1;
+	strscpy(info->value.enumerated.name,
+		names[info->value.enumerated.item],
+		sizeof(info->value.enumerated.name));
+
+	return 0;
+}
+
+int sim_ctl_info(struct snd_kcontrol *kctl, struct snd_ctl_elem_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	return kctl->new.info(kctl, info);
+}
+
+int sim_ctl_tlv_read(struct snd_kcontrol *kctl, unsigned int *tlv,
+		     unsigned int size)
+{
+	const unsigned int *p = kctl->new.tlv.p;
+
+	if (!(kctl->new.access & SNDRV_CTL_ELEM_ACCESS_TLV_READ))
+		return -ENXIO;
+
+	if (kctl->new.access & SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK)
+		return kctl->new.tlv.c(kctl, SNDRV_CTL_TLV_OP_READ, size, tlv);
+
+	if (!p)
+		return -ENXIO;
+	if (size < p[1] + 2 * sizeof(*p))
+		return -ENOMEM;
+
+	memcpy(tlv, p, p[1] + 2 * sizeof(*p));
+	return 0;
+}
+
+int sim_ctl_get(struct snd_kcontrol *kctl, struct snd_ctl_elem_value *val)
+{
+	memset(val, 0, sizeof(*val));
+	return kctl->new.get(kctl, val);
+}
+
+int sim_ctl_put(struct snd_kcontrol *kctl, struct snd_ctl_elem_value *val)
+{
+	if (!kctl->new.put)
+		return -EPERM;
+
+	return kctl->new.put(kctl, val);
+}
+
+/* Bind every registered component to the card, on one DAI link */
+int sim_card_bind(void)
+{
+	struct snd_soc_component *component;
+	const struct snd_soc_component_driver *drv;
+	int n = 0, ret;
+
+	list_for_each_entry(component, &sim_components, list) {
+		if (n == SIM_MAX_AMPS)
+			return -ENOSPC;
+
+		sim_card.components[n] = component;
+		sim_card.dais[n] = &container_of(component,
+						 struct sim_component,
+						 component)->dai;
+		n++;
+	}
+
+	sim_card.num_codecs = n;
+	sim_card.rtd.num_codecs = n;
+	sim_card.rtd.codec_dais = sim_card.dais;
+	sim_card.substream.stream = SNDRV_PCM_STREAM_PLAYBACK;
+	sim_card.substream.private_data = &sim_card.rtd;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		component = sim_card.components[n];
+		drv = component->driver;
+
+		ret = snd_soc_add_component_controls(component, drv->controls,
+						     drv->num_controls);
+		if (!ret && drv->probe)
+			ret = drv->probe(component);
+		if (ret)
+			return ret;
+
+		if (drv->debugfs_init)
+			drv->debugfs_init(component,
+					  debugfs_create_dir(dev_name(component->dev),
+							     NULL));
+	}
+
+	return 0;
+}
+
+void sim_card_unbind(void)
+{
+	struct snd_soc_component *component;
+	int n;
+
+	sim_card_power_down();
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		component = sim_card.components[n];
+		if (component->driver->remove)
+			component->driver->remove(component);
+		sim_free_controls(component);
+	}
+	sim_card.num_codecs = 0;
+}
+
+int sim_card_set_fmt(unsigned int fmt)
+{
+	struct snd_soc_dai *dai;
+	int n, ret;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		dai = sim_card.dais[n];
+		if (!dai->driver->ops->set_fmt)
+			continue;
+
+		ret = dai->driver->ops->set_fmt(dai, fmt);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void sim_dapm_event(int event)
+{
+	struct snd_soc_component *component;
+	struct snd_soc_dapm_widget w;
+	unsigned int i;
+	int n;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		component = sim_card.components[n];
+
+		for (i = 0; i < component->driver->num_dapm_widgets; i++) {
+			w = component->driver->dapm_widgets[i];
+			if (!w.event || !(w.event_flags & event))
+				continue;
+
+			w.dapm = &component->dapm;
+			w.event(&w, NULL, event);
+		}
+	}
+}
+
+void sim_card_power_down(void)
+{
+	sim_timer_del(&sim_card.pmdown);
+
+	if (!sim_card.powered)
+		return;
+
+	sim_dapm_event(SND_SOC_DAPM_PRE_PMD);
+	sim_dapm_event(SND_SOC_DAPM_POST_PMD);
+	sim_card.powered = false;
+}
+
+static void sim_card_pmdown(struct sim_timer *timer)
+{
+	sim_card_power_down();
+}
+
+int sim_card_mute(int mute)
+{
+	struct snd_soc_dai *dai;
+	int n, ret, err = 0;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		dai = sim_card.dais[n];
+		if (!dai->driver->ops->mute_stream)
+			continue;
+
+		ret = dai->driver->ops->mute_stream(dai, mute,
+						    SNDRV_PCM_STREAM_PLAYBACK);
+		err = err ?: ret;
+	}
+
+	return err;
+}
+
+/* open, prepare and trigger, then let the work it queued run */
+int sim_card_start(void)
+{
+	struct snd_pcm_substream *substream = &sim_card.substream;
+	const struct snd_soc_dai_ops *ops;
+	struct snd_soc_dai *dai;
+	int n, ret;
+
+	if (sim_card.running)
+		return -EBUSY;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		dai = sim_card.dais[n];
+		ops = dai->driver->ops;
+		if (ops->startup) {
+			ret = ops->startup(substream, dai);
+			if (ret)
+				return ret;
+		}
+	}
+
+	/* A stream that comes back within pmdown_time finds the DAC
+	 * still powered
+	 */
+	sim_timer_del(&sim_card.pmdown);
+	if (!sim_card.powered) {
+		sim_dapm_event(SND_SOC_DAPM_PRE_PMU);
+		sim_dapm_event(SND_SOC_DAPM_POST_PMU);
+		sim_card.powered = true;
+	}
+
+	ret = sim_card_mute(0);
+	if (ret)
+		return ret;
+
+	/* Nudge the clock so a PLAY written before the trigger is older */
+	sim_now++;
+	sim_card.trigger_time = sim_now;
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		dai = sim_card.dais[n];
+		ret = dai->driver->ops->trigger(substream,
+						SNDRV_PCM_TRIGGER_START, dai);
+		if (ret)
+			return ret;
+	}
+	sim_card.running = true;
+
+	sim_run();
+
+	return 0;
+}
+
+/* trigger, hw_free and close; DAPM powers down pmdown_ms later */
+int sim_card_stop(void)
+{
+	struct snd_pcm_substream *substream = &sim_card.substream;
+	const struct snd_soc_dai_ops *ops;
+	struct snd_soc_dai *dai;
+	int n, ret, err = 0;
+
+	if (!sim_card.running)
+		return 0;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		dai = sim_card.dais[n];
+		ret = dai->driver->ops->trigger(substream,
+						SNDRV_PCM_TRIGGER_STOP, dai);
+		err = err ?: ret;
+	}
+
+	ret = sim_card_mute(1);
+	err = err ?: ret;
+
+	for (n = 0; n < sim_card.num_codecs; n++) {
+		dai = sim_card.dais[n];
+		ops = dai->driver->ops;
+		if (ops->shutdown)
+			ops->shutdown(substream, dai);
+	}
+	sim_card.running = false;
+
+	sim_card.pmdown.fn = sim_card_pmdown;
+	if (sim_card.num_codecs &&
+	    sim_card.components[0]->driver->use_pmdown_time)
+		sim_timer_add(&sim_card.pmdown,
+			      sim_now + (s64)sim_card.pmdown_ms * NSEC_PER_MSEC);
+	else
+		sim_card_power_down();
+
+	sim_run();
+
+	return err;
+}